@@ -199,6 +199,28 @@ static size_t roffs_size(expr *offsexp,section *sec,taddr pc)
 }
 
 
+/* returns true when the size of an atom can never change, so it doesn't
+   require any resolver passes */
+static int fixed_size_atom(atom *p)
+{
+  switch(p->type) {
+    case LABEL:
+    case DATA:
+    case DATADEF:
+    case LINE:
+    case OPTS:
+    case PRINTTEXT:
+    case PRINTEXPR:
+    case ASSERT:
+    case NLIST:
+      return 1;
+    case INSTRUCTION:
+      return p->content.inst->code<0 || INST_SIZE_FIXED(p->content.inst);
+  }
+  return 0;  /* SPACE, ROFFS, RORG and RORGEND */
+}
+
+
 /* adds an atom to the specified section; if sec==0, the current
    section is used */
 void add_atom(section *sec,atom *a)
@@ -212,6 +234,7 @@ void add_atom(section *sec,atom *a)
   }
 
   a->changes = 0;
+  a->lastpass = 0;
   a->src = cur_src;
   a->line = cur_src!=NULL ? cur_src->line : 0;
 
@@ -221,8 +244,11 @@ void add_atom(section *sec,atom *a)
     pa->next = a;
     /* make sure that a label on the same line gets the same alignment */
     if (pa->type==LABEL && pa->line==a->line &&
-        (a->type==INSTRUCTION || a->type==DATADEF || a->type==SPACE))
+        (a->type==INSTRUCTION || a->type==DATADEF || a->type==SPACE)) {
       pa->align = a->align;
+      if (pcalign(pa,pa->content.label->pc) != pa->content.label->pc)
+        sec->flags |= NEEDS_RESOLVE;  /* label will move */
+    }
   }
   else
     sec->first = a;
@@ -232,6 +258,10 @@ void add_atom(section *sec,atom *a)
   sec->pc = pcalign(a,sec->pc);
   a->lastsize = atom_size(a,sec,sec->pc);
   sec->pc += a->lastsize;
+  if (!fixed_size_atom(a))
+    sec->flags |= NEEDS_RESOLVE;
+  if (profiling)
+    profile_atom(a);
   if (a->align > sec->align)
     sec->align = a->align;
 
@@ -89,6 +89,7 @@ typedef struct atom {
   taddr align;
   size_t lastsize;
   unsigned changes;
+  int lastpass;  /* last pass of the resolver which changed the size */
   source *src;
   int line;
   listing *list;
@@ -0,0 +1,499 @@
+/*
+ * vbench
+ * Benchmark suite for vasm. Generates synthetic sources for a number of
+ * workloads and cpu/syntax combinations, assembles them with the vasm
+ * executables in the current directory, and appends the results as JSON
+ * lines to a file.
+ *
+ * Usage: vbench [-c <commit>] [-o <file>] [-r <runs>] [-s <scale>]
+ *               [-w <workload>] [<target>...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define WORKDIR "bench/work"
+#define MAXPATH 1024
+#define MAXOPTS 8
+#define SECBRANCHES 1024    /* branches per section in the branch workload */
+#define ONESECBRANCHES 2048 /* branches of the branchsec workload */
+
+
+/* source templates for a cpu/syntax combination */
+struct target {
+  const char *name;         /* executable is vasm<name> */
+  const char *opts[MAXOPTS];
+  const char *header;       /* first lines of a source */
+  int orgsize;              /* bytes before restarting the address space */
+  const char *org;          /* restarts the address space at $1000+%d */
+  const char *section;      /* starts section number %d */
+  const char *code[4];      /* straight-line instructions */
+  int codesize;             /* maximum bytes of code[] */
+  const char *branch;       /* conditional branch to L<%d> */
+  const char *shortins;     /* small filler between branches */
+  const char *longins;      /* large filler between branches */
+  const char *macdef;       /* definition of macro "setab" with 2 arguments */
+  const char *maccall;      /* setab %d,%d */
+  const char *rept;         /* rept %d */
+  const char *endr;
+  const char *byte;         /* byte data directive */
+  const char *include;      /* include "%s" */
+  const char *equ;          /* s%d equ s%d+1 */
+  const char *equ0;         /* s0 equ 1 */
+};
+
+static struct target targets[] = {
+  { "m68k_mot", { "-Fvobj", NULL },
+    " section code,code\n", 0, NULL, " section code%d,code",
+    { " moveq #1,d0", " add.l d1,d2", " move.l (a0)+,d3", " lea 4(a1),a2" }, 4,
+    " bne L%d", " moveq #1,d0", " move.l #$12345678,d0",
+    "setab macro\n moveq #\\1,d0\n add.l #\\2,d1\n endm\n",
+    " setab %d,%d", " rept %d", " endr",
+    " dc.b", " include \"%s\"", "s%d equ s%d+1",
+    "s0 equ 1" },
+  { "6502_oldstyle", { "-Fvobj", "-opt-branch", NULL },
+    " org $1000\n", 0x8000, " org $%x", NULL,
+    { " lda #1", " sta $1234", " inx", " adc ($12),y" }, 3,
+    " bne L%d", " inx", " lda $1234",
+    "setab macro\n lda #\\1\n adc #\\2\n endm\n",
+    " setab %d,%d", " rept %d", " endr",
+    " byte", " include \"%s\"", "s%d equ s%d+1",
+    "s0 equ 1" },
+  { "z80_oldstyle", { "-Fvobj", "-opt-jr", NULL },
+    " org $1000\n", 0x8000, " org $%x", NULL,
+    { " ld a,1", " add a,b", " ld (ix+4),c", " ld hl,1234" }, 3,
+    " jp nz,L%d", " inc a", " ld hl,1234",
+    "setab macro\n ld a,\\1\n add a,\\2\n endm\n",
+    " setab %d,%d", " rept %d", " endr",
+    " db", " include \"%s\"", "s%d equ s%d+1",
+    "s0 equ 1" },
+  { "arm_std", { "-Fvobj", NULL },
+    " .text\n", 0, NULL, " .section .text%d,\"acrx\"",
+    { " mov r0,#1", " add r1,r2,r3", " ldr r4,[r5,#4]", " str r6,[r7],#8" }, 4,
+    " bne L%d", " mov r0,#1", " add r1,r2,r3,lsl #2",
+    " .macro setab a,b\n mov r0,#\\a\n add r1,r1,#\\b\n .endm\n",
+    " setab %d,%d", " .rept %d", " .endr",
+    " .byte", " .include \"%s\"", " .equ s%d,s%d+1",
+    " .equ s0,1" },
+  { "ppc_std", { "-Fvobj", "-opt-branch", NULL },
+    " .text\n", 0, NULL, " .section .text%d,\"acrx\"",
+    { " li r3,1", " add r4,r5,r6", " lwz r7,4(r8)", " stw r9,8(r10)" }, 4,
+    " bne L%d", " li r3,1", " addis r4,r4,1",
+    " .macro setab a,b\n li r3,\\a\n addi r4,r4,\\b\n .endm\n",
+    " setab %d,%d", " .rept %d", " .endr",
+    " .byte", " .include \"%s\"", " .equ s%d,s%d+1",
+    " .equ s0,1" },
+};
+#define NTARGETS (sizeof(targets)/sizeof(targets[0]))
+
+static const char *workloads[] = {
+  "flat", "branch", "branchsec", "macro", "data", "include", "equ"
+};
+#define NWORKLOADS (sizeof(workloads)/sizeof(workloads[0]))
+
+static FILE *src;           /* current generated file */
+static unsigned long lines; /* lines generated for the current workload */
+static unsigned long orgbytes;
+static int orgs;
+static unsigned long seed;
+static int scale = 1;
+
+
+static void out(const char *fmt,...)
+{
+  va_list vl;
+
+  va_start(vl,fmt);
+  vfprintf(src,fmt,vl);
+  va_end(vl);
+  fputc('\n',src);
+  lines++;
+}
+
+
+static void out_text(const char *text)
+{
+  const char *p;
+
+  fputs(text,src);
+  for (p=text; *p; p++) {
+    if (*p == '\n')
+      lines++;
+  }
+}
+
+
+/* restart the address space of 8-bit cpus before it overflows, with a
+   new address for every restart, so a new section is started */
+static void org_check(struct target *t,unsigned long bytes)
+{
+  if (t->org != NULL) {
+    orgbytes += bytes;
+    if (orgbytes > (unsigned long)t->orgsize) {
+      out(t->org,0x1000+ ++orgs);
+      orgbytes = bytes;
+    }
+  }
+}
+
+
+static unsigned long rnd(unsigned long n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+
+static FILE *create(const char *dir,const char *name)
+{
+  char path[MAXPATH];
+  FILE *f;
+
+  snprintf(path,MAXPATH,"%s/%s",dir,name);
+  if ((f = fopen(path,"w")) == NULL) {
+    fprintf(stderr,"vbench: cannot create %s\n",path);
+    exit(EXIT_FAILURE);
+  }
+  return f;
+}
+
+
+/* large flat code */
+static void gen_flat(struct target *t)
+{
+  long i,n = 100000L * scale;
+
+  for (i=0; i<n; i++) {
+    org_check(t,t->codesize);
+    out("%s",t->code[i&3]);
+  }
+}
+
+
+/* dense forward branches over varying distances, which makes the resolver
+   work on branch sizes depending on each other. Unless onesec is set, a
+   new section is started every SECBRANCHES branches, as the 8-bit cpus
+   do with an org. The m68k resolver shrinks only one branch per pass in
+   its safe phase, so a single section gets fewer branches to converge. */
+static void gen_branch(struct target *t,int onesec)
+{
+  long i,n = (onesec ? ONESECBRANCHES : 40000L) * scale;
+  long blk,end;
+
+  for (blk=0; blk<n; blk=end) {
+    end = blk + 256;
+    org_check(t,256*8);
+    if (!onesec && t->section!=NULL && blk>0 && blk%SECBRANCHES==0)
+      out(t->section,(int)(blk/SECBRANCHES));
+    for (i=blk; i<end; i++) {
+      long dest = i + 1 + rnd(32);
+
+      /* stay in the block, which never crosses an org */
+      out("L%ld:",i);
+      out(t->branch,(int)(dest<end?dest:end-1));
+      out("%s",rnd(4)?t->shortins:t->longins);
+    }
+  }
+}
+
+
+/* macro calls and repeat blocks */
+static void gen_macro(struct target *t)
+{
+  long i,n = 20000L * scale;
+
+  out_text(t->macdef);
+  for (i=0; i<n; i++) {
+    org_check(t,40*8);
+    out(t->maccall,(int)(i&63),(int)(i%7));
+    if (i%20 == 0) {
+      out(t->rept,10);
+      out(t->maccall,1,2);
+      out("%s",t->code[0]);
+      out("%s",t->endr);
+    }
+  }
+}
+
+
+/* huge data tables */
+static void gen_data(struct target *t)
+{
+  long i,n = 50000L * scale;
+  int j;
+
+  for (i=0; i<n; i++) {
+    org_check(t,16);
+    fputs(t->byte,src);
+    for (j=0; j<16; j++)
+      fprintf(src,"%c%d",j?',':' ',(int)((i*16+j)&255));
+    out("");
+  }
+}
+
+
+/* include trees with fanout 4 and depth 6, each file defines symbols */
+static void gen_include_file(struct target *t,const char *dir,int depth,
+                             int *fileno)
+{
+  char name[64];
+  FILE *parent = src;
+  int i,base = ++*fileno * 100;
+
+  snprintf(name,sizeof(name),"inc%d.i",*fileno);
+  src = create(dir,name);
+  out(t->equ,base,0);
+  for (i=1; i<20; i++)
+    out(t->equ,base+i,base+i-1);
+  if (depth > 0) {
+    for (i=0; i<4; i++) {
+      snprintf(name,sizeof(name),"inc%d.i",*fileno+1);
+      out(t->include,name);
+      gen_include_file(t,dir,depth-1,fileno);
+    }
+  }
+  fclose(src);
+  src = parent;
+}
+
+static void gen_include(struct target *t,const char *dir)
+{
+  char name[64];
+  int fileno = 0;
+  int i;
+
+  out("%s",t->equ0);
+  for (i=0; i<scale; i++) {
+    snprintf(name,sizeof(name),"inc%d.i",fileno+1);
+    out(t->include,name);
+    gen_include_file(t,dir,6,&fileno);
+  }
+}
+
+
+/* long chain of symbols, each depending on the previous one */
+static void gen_equ(struct target *t)
+{
+  long i,n = 100000L * scale;
+
+  out("%s",t->equ0);
+  for (i=1; i<n; i++)
+    out(t->equ,(int)i,(int)(i-1));
+}
+
+
+static void generate(struct target *t,const char *workload,const char *dir)
+{
+  lines = orgbytes = 0;
+  orgs = 0;
+  seed = 1;
+  src = create(dir,"main.s");
+  out_text(t->header);
+  if (!strcmp(workload,"flat"))
+    gen_flat(t);
+  else if (!strcmp(workload,"branch"))
+    gen_branch(t,0);
+  else if (!strcmp(workload,"branchsec"))
+    gen_branch(t,1);
+  else if (!strcmp(workload,"macro"))
+    gen_macro(t);
+  else if (!strcmp(workload,"data"))
+    gen_data(t);
+  else if (!strcmp(workload,"include"))
+    gen_include(t,dir);
+  else if (!strcmp(workload,"equ"))
+    gen_equ(t);
+  fclose(src);
+}
+
+
+/* Assemble main.s in dir. Returns the exit status, the wall time in
+   seconds and the peak RSS in KB. With debug, counts the resolver passes
+   from the output instead. */
+static int assemble(struct target *t,const char *exe,const char *dir,
+                    int debug,double *secs,long *rss,long *passes)
+{
+  const char *argv[MAXOPTS+8];
+  struct timespec t0,t1;
+  struct rusage ru;
+  int i,argc,status,pfd[2];
+  pid_t pid;
+
+  argc = 0;
+  argv[argc++] = exe;
+  argv[argc++] = "-quiet";
+  for (i=0; t->opts[i]; i++)
+    argv[argc++] = t->opts[i];
+  if (debug)
+    argv[argc++] = "-debug";
+  argv[argc++] = "-o";
+  argv[argc++] = "out.o";
+  argv[argc++] = "main.s";
+  argv[argc] = NULL;
+
+  if (debug && pipe(pfd)<0)
+    return -1;
+  clock_gettime(CLOCK_MONOTONIC,&t0);
+  if ((pid = fork()) == 0) {
+    int fd = open("/dev/null",O_WRONLY);
+
+    if (chdir(dir) < 0)
+      _exit(127);
+    dup2(debug?pfd[1]:fd,1);
+    dup2(fd,2);
+    if (debug) {
+      close(pfd[0]);
+      close(pfd[1]);
+    }
+    execv(exe,(char **)argv);
+    _exit(127);
+  }
+  if (pid < 0)
+    return -1;
+  if (debug) {
+    FILE *f;
+    char buf[256];
+
+    close(pfd[1]);
+    f = fdopen(pfd[0],"r");
+    *passes = 0;
+    while (fgets(buf,sizeof(buf),f)) {
+      if (!strncmp(buf,"resolve_section(",16) && strstr(buf,") pass "))
+        ++*passes;
+    }
+    fclose(f);
+  }
+  if (wait4(pid,&status,0,&ru) < 0)
+    return -1;
+  clock_gettime(CLOCK_MONOTONIC,&t1);
+  if (secs)
+    *secs = (t1.tv_sec-t0.tv_sec) + (t1.tv_nsec-t0.tv_nsec)/1e9;
+  if (rss)
+    *rss = ru.ru_maxrss;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+
+static void mkdirs(const char *path)
+{
+  char buf[MAXPATH],*p;
+
+  snprintf(buf,MAXPATH,"%s",path);
+  for (p=buf+1; *p; p++) {
+    if (*p == '/') {
+      *p = '\0';
+      mkdir(buf,0777);
+      *p = '/';
+    }
+  }
+  mkdir(buf,0777);
+}
+
+
+int main(int argc,char *argv[])
+{
+  const char *commit = "";
+  const char *outname = "bench/results.jsonl";
+  const char *onlywl = NULL;
+  char cwd[MAXPATH],exe[MAXPATH],dir[MAXPATH];
+  int runs = 3;
+  int i,n,w,selected;
+  FILE *res;
+
+  for (i=1; i<argc && argv[i][0]=='-'; i++) {
+    if (i+1 >= argc) {
+      fprintf(stderr,"vbench: option %s needs an argument\n",argv[i]);
+      return EXIT_FAILURE;
+    }
+    if (!strcmp(argv[i],"-c"))
+      commit = argv[++i];
+    else if (!strcmp(argv[i],"-o"))
+      outname = argv[++i];
+    else if (!strcmp(argv[i],"-r"))
+      runs = atoi(argv[++i]);
+    else if (!strcmp(argv[i],"-s"))
+      scale = atoi(argv[++i]);
+    else if (!strcmp(argv[i],"-w"))
+      onlywl = argv[++i];
+    else {
+      fprintf(stderr,"vbench: unknown option %s\n",argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (runs < 1)
+    runs = 1;
+  if (scale < 1)
+    scale = 1;
+  if (getcwd(cwd,MAXPATH) == NULL)
+    return EXIT_FAILURE;
+  if ((res = fopen(outname,"a")) == NULL) {
+    fprintf(stderr,"vbench: cannot open %s\n",outname);
+    return EXIT_FAILURE;
+  }
+
+  printf("%-14s %-10s %8s %9s %10s %6s %8s\n",
+         "target","workload","lines","seconds","lines/s","passes","rss(KB)");
+  for (n=0; n<(int)NTARGETS; n++) {
+    struct target *t = &targets[n];
+
+    for (selected=(i>=argc),w=i; w<argc; w++) {
+      if (!strcmp(argv[w],t->name))
+        selected = 1;
+    }
+    if (!selected)
+      continue;
+    if (snprintf(exe,MAXPATH,"%s/vasm%.64s",cwd,t->name) >= MAXPATH ||
+        access(exe,X_OK) != 0) {
+      fprintf(stderr,"vbench: %s not found, skipped\n",exe);
+      continue;
+    }
+
+    for (w=0; w<(int)NWORKLOADS; w++) {
+      double secs,best = 0.0;
+      long rss,maxrss = 0,passes = 0;
+      int r,status = 0;
+
+      if (onlywl && strcmp(onlywl,workloads[w]))
+        continue;
+      if (snprintf(dir,MAXPATH,"%s/%s/%.64s/%.64s",cwd,WORKDIR,t->name,
+                   workloads[w]) >= MAXPATH) {
+        fprintf(stderr,"vbench: path too long\n");
+        return EXIT_FAILURE;
+      }
+      mkdirs(dir);
+      generate(t,workloads[w],dir);
+
+      for (r=0; r<runs; r++) {
+        status = assemble(t,exe,dir,0,&secs,&rss,NULL);
+        if (r==0 || secs<best)
+          best = secs;
+        if (rss > maxrss)
+          maxrss = rss;
+      }
+      assemble(t,exe,dir,1,NULL,NULL,&passes);
+
+      printf("%-14s %-10s %8lu %9.4f %10.0f %6ld %8ld%s\n",
+             t->name,workloads[w],lines,best,lines/best,passes,maxrss,
+             status?"  FAILED":"");
+      fprintf(res,"{\"commit\":\"%s\",\"time\":%ld,\"target\":\"%s\","
+              "\"workload\":\"%s\",\"scale\":%d,\"lines\":%lu,\"runs\":%d,"
+              "\"seconds\":%.6f,\"lines_per_sec\":%.0f,\"passes\":%ld,"
+              "\"max_rss_kb\":%ld,\"status\":%d}\n",
+              commit,(long)time(NULL),t->name,workloads[w],scale,lines,runs,
+              best,lines/best,passes,maxrss,status);
+      fflush(stdout);
+    }
+  }
+  fclose(res);
+  return EXIT_SUCCESS;
+}
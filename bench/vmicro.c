@@ -0,0 +1,385 @@
+/*
+ * vmicro
+ * Microbenchmarks for the core of vasm, linked with the test cpu and
+ * syntax modules, so no real backend is involved.
+ * Every benchmark runs a fixed number of operations and reports the
+ * time per operation.
+ *
+ * Usage: vmicro [-c <commit>] [-o <file>] [-s <scale>] [<benchmark>...]
+ */
+
+#include <time.h>
+#include "vasm.h"
+
+#define NSYMS      200000
+#define NEXPRS     200000
+#define NLINES     500000
+#define NMACROS    100000
+#define NATOMS     200000
+#define NBRANCHES  50000
+
+struct bench {
+  const char *name;
+  long (*func)(long);       /* returns the number of operations done */
+  long n;
+};
+
+static struct timespec t0;
+
+
+static void start(void)
+{
+  clock_gettime(CLOCK_MONOTONIC,&t0);
+}
+
+
+static double elapsed(void)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC,&t1);
+  return (t1.tv_sec-t0.tv_sec) + (t1.tv_nsec-t0.tv_nsec)/1e9;
+}
+
+
+/* The timed part of a benchmark is between start() and stop(), the
+   result is reported by main(). */
+static double timed;
+
+static void stop(void)
+{
+  timed = elapsed();
+}
+
+
+static char **make_names(const char *fmt,long n)
+{
+  char **names = mymalloc(n*sizeof(char *));
+  char buf[32];
+  long i;
+
+  for (i=0; i<n; i++) {
+    snprintf(buf,sizeof(buf),fmt,i);
+    names[i] = mystrdup(buf);
+  }
+  return names;
+}
+
+
+/* make a source from n copies of a line */
+static source *make_source(const char *head,const char *line,long n)
+{
+  size_t hl = strlen(head), ll = strlen(line);
+  char *text = mymalloc(hl+ll*n+1);
+  char *p = text;
+  long i;
+
+  memcpy(p,head,hl);
+  p += hl;
+  for (i=0; i<n; i++) {
+    memcpy(p,line,ll);
+    p += ll;
+  }
+  *p = '\0';
+  return new_source("micro",NULL,text,p-text);
+}
+
+
+static long symtab_insert(long n)
+{
+  hashtable *ht = new_hashtable(0x10000);
+  char **names = make_names("sym%ld",n);
+  hashdata data;
+  long i;
+
+  start();
+  for (i=0; i<n; i++) {
+    data.idx = i;
+    add_hashentry(ht,names[i],data);
+  }
+  stop();
+  return n;
+}
+
+
+static long symtab_lookup(long n)
+{
+  hashtable *ht = new_hashtable(0x10000);
+  char **names = make_names("sym%ld",n);
+  char **misses = make_names("nosym%ld",n);
+  hashdata data;
+  long i,found = 0;
+
+  for (i=0; i<n; i++) {
+    data.idx = i;
+    add_hashentry(ht,names[i],data);
+  }
+  start();
+  for (i=0; i<n; i++) {
+    found += find_name(ht,names[i],&data);
+    found += find_name(ht,misses[i],&data);
+  }
+  stop();
+  if (found != n)
+    fprintf(stderr,"vmicro: symtab_lookup found %ld of %ld\n",found,n);
+  return 2*n;
+}
+
+
+/* Labels stay symbols in a parsed expression, while the trees of
+   absolute symbols would be copied and folded into a constant. */
+static section *exprsec;
+
+static void define_expr_symbols(void)
+{
+  if (exprsec == NULL) {
+    exprsec = new_section("expr","acrx",1);
+    exprsec->pc = 7;
+    new_labsym(exprsec,"a");
+    exprsec->pc = 21;
+    new_labsym(exprsec,"b");
+    exprsec->pc = 14;
+    new_labsym(exprsec,"c");
+    exprsec->pc = 0;
+  }
+}
+
+static char exprtext[] = "(a+3)*b-c/2+$1f&%1111|(b<<2)";
+
+static long expr_parse(long n)
+{
+  expr *tree;
+  char *s;
+  long i;
+
+  define_expr_symbols();
+  start();
+  for (i=0; i<n; i++) {
+    s = exprtext;
+    tree = parse_expr(&s);
+    free_expr(tree);
+  }
+  stop();
+  return n;
+}
+
+
+static long expr_eval(long n)
+{
+  expr *tree;
+  taddr val,sum = 0;
+  char *s = exprtext;
+  long i;
+
+  define_expr_symbols();
+  tree = parse_expr(&s);
+  start();
+  for (i=0; i<n; i++) {
+    eval_expr(tree,&val,exprsec,0);  /* not constant, with labels */
+    sum += val;
+  }
+  stop();
+  free_expr(tree);
+  return n;
+}
+
+
+static long read_line(long n)
+{
+  long lines = 0;
+
+  cur_src = NULL;  /* new sources must not return to a parent */
+  cur_src = make_source(""," add r1,r2 ; comment\n",n);
+  start();
+  while (read_next_line())
+    lines++;
+  stop();
+  return lines;
+}
+
+
+static long read_line_macro(long n)
+{
+  long lines = 0;
+  source *src;
+  char *s;
+
+  /* define the macro through the parser, then read n calls */
+  cur_src = NULL;
+  cur_src = make_source(" macro mac4\n add \\1,\\2\n move \\2,r3\n"
+                        " addq #\\3,\\1\n add \\2,\\1\n endm\n","",0);
+  parse();
+  cur_src = NULL;
+  src = cur_src = make_source(""," mac4 r1,r2,4\n",n);
+  start();
+  while ((s = read_next_line()) != NULL) {
+    if (cur_src == src) {
+      s = skip(s);
+      if (!execute_macro(s,4,NULL,NULL,0,s+4))
+        break;
+    }
+    else
+      lines++;
+  }
+  stop();
+  return lines;
+}
+
+
+static atom **make_atoms(long n)
+{
+  atom **atoms = mymalloc(n*sizeof(atom *));
+  char *op[2] = { "r1", "r2" };
+  int op_len[2] = { 2, 2 };
+  long i;
+
+  for (i=0; i<n; i++)
+    atoms[i] = new_inst_atom(new_inst("add",3,2,op,op_len));
+  return atoms;
+}
+
+
+static long add_atoms(long n)
+{
+  atom **atoms = make_atoms(n);
+  section *sec = new_section("add_atom","acrx",1);
+  long i;
+
+  start();
+  for (i=0; i<n; i++)
+    add_atom(sec,atoms[i]);
+  stop();
+  sec->flags &= ~NEEDS_RESOLVE;
+  myfree(atoms);
+  return n;
+}
+
+
+static long atom_sizes(long n)
+{
+  atom **atoms = make_atoms(n);
+  section *sec = new_section("atom_size","acrx",1);
+  size_t size = 0;
+  atom *p;
+  long i;
+
+  for (i=0; i<n; i++)
+    add_atom(sec,atoms[i]);
+  sec->flags &= ~NEEDS_RESOLVE;
+  myfree(atoms);
+  start();
+  for (p=sec->first; p; p=p->next)
+    size += atom_size(p,sec,size);
+  stop();
+  return n;
+}
+
+
+/* Labels with branches over varying distances. The resolver runs over
+   this section only, an operation is an atom of the section. */
+static long resolve_loop(long n)
+{
+  section *sec = new_section("resolve","acrx",1);
+  char **labels = make_names("L%ld",n+1);
+  char *op[2];
+  int op_len[2];
+  unsigned long seed = 1;
+  long i,atoms = 0;
+
+  set_section(sec);
+  for (i=0; i<n; i++) {
+    long dest;
+
+    seed = seed * 1103515245 + 12345;
+    dest = i + 1 + (long)((seed>>16) % 40);
+    if (dest > n)
+      dest = n;
+    add_atom(sec,new_label_atom(new_labsym(sec,labels[i])));
+    op[0] = labels[dest];
+    op_len[0] = strlen(op[0]);
+    add_atom(sec,new_inst_atom(new_inst("bra",3,1,op,op_len)));
+    op[0] = "r1";
+    op[1] = (seed>>24)&1 ? "r2" : "$12345678";
+    op_len[0] = 2;
+    op_len[1] = strlen(op[1]);
+    add_atom(sec,new_inst_atom(new_inst("add",3,2,op,op_len)));
+    atoms += 3;
+  }
+  add_atom(sec,new_label_atom(new_labsym(sec,labels[n])));
+  start();
+  resolve();
+  stop();
+  return atoms+1;
+}
+
+
+static struct bench benchmarks[] = {
+  { "symtab_insert", symtab_insert, NSYMS },
+  { "symtab_lookup", symtab_lookup, NSYMS },
+  { "expr_parse", expr_parse, NEXPRS },
+  { "expr_eval", expr_eval, NEXPRS },
+  { "read_line", read_line, NLINES },
+  { "read_line_macro", read_line_macro, NMACROS },
+  { "add_atom", add_atoms, NATOMS },
+  { "atom_size", atom_sizes, NATOMS },
+  { "resolve", resolve_loop, NBRANCHES },
+};
+#define NBENCH (sizeof(benchmarks)/sizeof(benchmarks[0]))
+
+
+int main(int argc,char *argv[])
+{
+  const char *commit = "";
+  FILE *res = NULL;
+  int scale = 1;
+  int i,j,n;
+
+  for (i=1; i<argc && argv[i][0]=='-'; i+=2) {
+    if (i+1 >= argc) {
+      fprintf(stderr,"vmicro: option %s needs an argument\n",argv[i]);
+      return EXIT_FAILURE;
+    }
+    if (!strcmp(argv[i],"-c"))
+      commit = argv[i+1];
+    else if (!strcmp(argv[i],"-o")) {
+      if ((res = fopen(argv[i+1],"a")) == NULL) {
+        fprintf(stderr,"vmicro: cannot open %s\n",argv[i+1]);
+        return EXIT_FAILURE;
+      }
+    }
+    else if (!strcmp(argv[i],"-s"))
+      scale = atoi(argv[i+1]);
+    else {
+      fprintf(stderr,"vmicro: unknown option %s\n",argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (scale < 1)
+    scale = 1;
+
+  if (!init_main() || !init_symbol() || !init_parse() || !init_syntax() ||
+      !init_cpu()) {
+    fprintf(stderr,"vmicro: initialization failed\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("%-16s %10s %10s %10s\n","benchmark","ops","ms","ns/op");
+  for (n=0; n<(int)NBENCH; n++) {
+    struct bench *b = &benchmarks[n];
+    long ops;
+
+    for (j=i; j<argc && strcmp(argv[j],b->name); j++);
+    if (i<argc && j>=argc)
+      continue;
+    ops = b->func(b->n*scale);
+    printf("%-16s %10ld %10.2f %10.1f\n",b->name,ops,timed*1e3,timed*1e9/ops);
+    fflush(stdout);
+    if (res)
+      fprintf(res,"{\"commit\":\"%s\",\"time\":%ld,\"benchmark\":\"%s\","
+              "\"ops\":%ld,\"seconds\":%.6f,\"ns_per_op\":%.1f}\n",
+              commit,(long)time(NULL),b->name,ops,timed,timed*1e9/ops);
+  }
+  if (res)
+    fclose(res);
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -18,9 +18,37 @@ int bytespertaddr = 2;
 
 static uint16_t cpu_type = M6502;
 static int branchopt = 0;
+static int listcycles = 0;  /* show cycles in the listing */
 static int modifier;      /* set by find_base() */
 static utaddr dpage = 0;  /* default zero/direct page - set with SETDP */
 
+/* cycle budget of a code range, between CYCLES and ENDCYCLES */
+static struct cyccmd *cycrange_open;  /* parser state */
+static int cycrange_active;
+static int cycrange_budget;
+static int cycrange_min,cycrange_max;
+
+/* NMOS 6502 base cycles by opcode, including illegal instructions */
+static const unsigned char cycles_6502[256] = {
+  7,6,0,8,3,3,5,5,3,2,2,2,4,4,6,6, 2,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  6,6,0,8,3,3,5,5,4,2,2,2,4,4,6,6, 2,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  6,6,0,8,3,3,5,5,3,2,2,2,3,4,6,6, 2,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  6,6,0,8,3,3,5,5,4,2,2,2,5,4,6,6, 2,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  2,6,2,6,3,3,3,3,2,2,2,2,4,4,4,4, 2,6,0,6,4,4,4,4,2,5,2,5,5,5,5,5,
+  2,6,2,6,3,3,3,3,2,2,2,2,4,4,4,4, 2,5,0,5,4,4,4,4,2,4,2,4,4,4,4,4,
+  2,6,2,8,3,3,5,5,2,2,2,2,4,4,6,6, 2,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  2,6,2,8,3,3,5,5,2,2,2,2,4,4,6,6, 2,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7
+};
+
+/* cycle range commands in OPTS atoms */
+typedef struct cyccmd {
+  int cmd;
+  int budget;
+  int open;  /* no endcycles seen until the end of the source */
+} cyccmd;
+#define CYC_BEGIN 1
+#define CYC_END 2
+
 
 int ext_unary_eval(int type,taddr val,taddr *result,int cnst)
 {
@@ -155,6 +183,37 @@ char *parse_cpu_special(char *start)
       eol(s);
       return skip_line(s);
     }
+    else if (s-name==6 && !strnicmp(name,"cycles",6)) {
+      cyccmd *cmd = mymalloc(sizeof(cyccmd));
+
+      s = skip(s);
+      cmd->cmd = CYC_BEGIN;
+      cmd->budget = (int)parse_constexpr(&s);
+      if (cycrange_open) {
+        cpu_error(9,"cycles","endcycles");  /* missing endcycles */
+        cycrange_open->open = 0;
+      }
+      cmd->open = 1;
+      cycrange_open = cmd;
+      add_atom(0,new_opts_atom(cmd));
+      eol(s);
+      return skip_line(s);
+    }
+    else if (s-name==9 && !strnicmp(name,"endcycles",9)) {
+      cyccmd *cmd = mymalloc(sizeof(cyccmd));
+
+      cmd->cmd = CYC_END;
+      cmd->budget = 0;
+      cmd->open = 0;
+      if (cycrange_open)
+        cycrange_open->open = 0;
+      else
+        cpu_error(9,"endcycles","cycles");  /* missing cycles */
+      cycrange_open = NULL;
+      add_atom(0,new_opts_atom(cmd));
+      eol(s);
+      return skip_line(s);
+    }
   }
   return start;
 }
@@ -331,6 +390,109 @@ static void rangecheck(taddr val,operand *op)
 }
 
 
+static int base_cycles(unsigned char oc)
+/* return number of cycles for an opcode, 0 when unknown */
+{
+  if (cpu_type & (CSGCE02|HU6280))
+    return 0;  /* different timing, not supported */
+
+  if (cpu_type & M65C02) {
+    if ((cpu_type & WDC02) && (oc&7)==7)
+      return 5;  /* RMB/SMB/BBR/BBS */
+    switch (oc) {
+      case 0x04: case 0x14: return 5;  /* TSB/TRB zp */
+      case 0x0c: case 0x1c: return 6;  /* TSB/TRB abs */
+      case 0x12: case 0x32: case 0x52: case 0x72:
+      case 0x92: case 0xb2: case 0xd2: case 0xf2: return 5;  /* (zp) */
+      case 0x1a: case 0x3a: case 0x89: return 2;
+      case 0x34: case 0x3c: case 0x74: return 4;
+      case 0x1e: case 0x3e: case 0x5e: case 0x7e: return 6;
+      case 0x5a: case 0xda: case 0x64: case 0x80: return 3;
+      case 0x7a: case 0xfa: case 0x9c: return 4;
+      case 0x6c: case 0x7c: return 6;
+      case 0x9e: return 5;
+      case 0xcb: case 0xdb: return (cpu_type & WDC02) ? 3 : 2;
+    }
+  }
+  else if (cpu_type & DTV) {
+    if (oc==0x12 || oc==0x32 || oc==0x42)
+      return 0;  /* BRA/SAC/SIR */
+  }
+  return cycles_6502[oc];
+}
+
+
+static int page_penalty(unsigned char oc)
+/* return true when crossing a page with an indexed access costs a cycle */
+{
+  switch (oc) {
+    case 0x11: case 0x31: case 0x51: case 0x71:  /* (zp),Y */
+    case 0xb1: case 0xd1: case 0xf1: case 0xb3:
+    case 0x19: case 0x39: case 0x59: case 0x79:  /* abs,Y */
+    case 0xb9: case 0xd9: case 0xf9: case 0xbb: case 0xbe: case 0xbf:
+    case 0x1d: case 0x3d: case 0x5d: case 0x7d:  /* abs,X */
+    case 0xbd: case 0xdd: case 0xfd: case 0xbc: case 0x3c:
+    case 0xdc: case 0xfc:
+      return 1;
+    case 0x1c: case 0x5c: case 0x7c:
+      return !(cpu_type & M65C02);
+    case 0x1e: case 0x3e: case 0x5e: case 0x7e:
+      return (cpu_type & M65C02) != 0;
+  }
+  return 0;
+}
+
+
+static void count_cycles(dblock *db,taddr pc)
+/* determine cycles of an assembled instruction for listing and budget */
+{
+  unsigned char *d = db->data;
+  int cyc,xcyc=0,pgcross=0;
+
+  if ((cyc = base_cycles(d[0])) == 0)
+    return;
+
+  if (db->size==5 && d[2]==0x4c) {
+    /* B!cc *+3 / JMP: 3 cycles when not jumping, 5 otherwise */
+    cyc = 3;
+    xcyc = 2;
+  }
+  else if ((d[0]&0x1f)==0x10 || (d[0]==0x80 && (cpu_type&M65C02)) ||
+           ((d[0]&0x0f)==0x0f && (cpu_type&WDC02))) {
+    /* branch: +1 when taken, +2 when taken to a different page */
+    utaddr next = (utaddr)pc + db->size;
+    utaddr dest = next + (signed char)d[db->size-1];
+
+    if (db->relocs!=NULL || ((next^dest)&0xff00)!=0) {
+      xcyc = 2;
+      pgcross = 1;
+    }
+    else
+      xcyc = 1;
+    if (d[0] == 0x80)
+      xcyc--;  /* BRA is always taken */
+  }
+  else if (page_penalty(d[0])) {
+    /* indexed access may cross a page, unless abs. base is page aligned */
+    if (db->size==2 || d[1]!=0 || db->relocs!=NULL) {
+      xcyc = 1;
+      pgcross = 1;
+    }
+  }
+
+  if (cycrange_active) {
+    cycrange_min += cyc;
+    cycrange_max += cyc + xcyc;
+  }
+  if (cur_listing!=NULL && listcycles) {
+    cur_listing->cycles += cyc;
+    cur_listing->xcycles += xcyc;
+    if (pgcross)
+      cur_listing->pgcross = 1;
+  }
+}
+
+
 dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
 {
   dblock *db = new_dblock();
@@ -471,6 +633,7 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
     }
   }
 
+  count_cycles(db,pc);
   return db;
 }
 
@@ -545,6 +708,43 @@ int cpu_available(int idx)
 }
 
 
+void cpu_opts(void *opts)
+/* begin or end a cycle range */
+{
+  cyccmd *cmd = (cyccmd *)opts;
+
+  if (cmd->cmd == CYC_BEGIN) {
+    if (final_pass && cmd->open)
+      cpu_error(9,"cycles","endcycles");  /* still open at end of source */
+    cycrange_active = 1;
+    cycrange_budget = cmd->budget;
+    cycrange_min = cycrange_max = 0;
+  }
+  else if (cycrange_active) {
+    if (final_pass && cycrange_max>cycrange_budget)
+      cpu_error(8,cycrange_budget,cycrange_min,cycrange_max);
+    cycrange_active = 0;
+  }
+}
+
+
+void cpu_opts_init(section *s)
+{
+  /* no initial options */
+}
+
+
+void print_cpu_opts(FILE *f,void *opts)
+{
+  cyccmd *cmd = (cyccmd *)opts;
+
+  if (cmd->cmd == CYC_BEGIN)
+    fprintf(f,"cycles %d",cmd->budget);
+  else
+    fprintf(f,"endcycles");
+}
+
+
 int init_cpu()
 {
   return 1;
@@ -555,6 +755,8 @@ int cpu_args(char *p)
 {
   if (!strcmp(p,"-opt-branch"))
     branchopt = 1;
+  else if (!strcmp(p,"-cycles"))
+    listcycles = 1;
   else if (!strcmp(p,"-illegal"))
     cpu_type |= ILL;
   else if (!strcmp(p,"-dtv"))
@@ -29,6 +29,9 @@ typedef uint16_t utaddr;
 /* returns true when instruction is valid for selected cpu */
 #define MNEMONIC_VALID(i) cpu_available(i)
 
+/* OPTS atoms mark the begin and end of a cycle counting range */
+#define HAVE_CPU_OPTS 1
+
 /* we define two additional unary operations, '<' and '>' */
 int ext_unary_eval(int,taddr,taddr *,int);
 int ext_find_base(symbol **,expr *,section *,taddr);
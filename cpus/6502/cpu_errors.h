@@ -6,3 +6,5 @@
   "operand doesn't fit into 8-bits",ERROR,                           /* 05 */
   "branch destination out of range",ERROR,
   "illegal bit number",ERROR,
+  "cycle budget of %d exceeded (%d to %d cycles)",ERROR,
+  "%s without %s",ERROR,
@@ -143,6 +143,21 @@ parse_operand(char *p, int len, operand *op, int required)
 }
 
 
+/* Only an address operand may be optimized between DIR and EXT. Its size
+   is fixed, when the address is a constant. */
+int
+m6800_fixed_size(operand **ops)
+{
+	int i;
+
+	for (i = 0; i < MAX_OPERANDS && ops[i] != NULL; i++) {
+		if (ops[i]->type == ADDR && ops[i]->value->type != NUM)
+			return 0;
+	}
+	return 1;
+}
+
+
 static size_t
 eval_oper(operand *op, section *sec, taddr pc, taddr offs, dblock *db)
 {
@@ -29,6 +29,9 @@ typedef uint16_t utaddr;
 /* returns true when instruction is valid for selected cpu */
 #define MNEMONIC_VALID(i) cpu_available(i)
 
+/* returns true when the instruction's size can never change */
+#define INST_SIZE_FIXED(ip) m6800_fixed_size((ip)->op)
+
 /* allow commas and blanks at the same time to separate instruction operands */
 #define OPERSEP_COMMA 1
 #define OPERSEP_BLANK 1
@@ -78,3 +81,4 @@ typedef struct {
 
 /* exported by cpu.c */
 int cpu_available(int);
+int m6800_fixed_size(operand **);
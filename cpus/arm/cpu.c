@@ -55,6 +55,20 @@ static int last_data_type = -1; /* for mapping symbol generation */
 #define THB_PREFETCH 4          /* prefetch-correction for Thumb-branches */
 #define ARM_PREFETCH 8          /* prefetch-correction for ARM-branches */
 
+/* literal pools for LDR Rd,=expr */
+struct literal {
+  struct literal *next;
+  expr *value;
+  symbol *label;
+};
+struct litpool {
+  struct litpool *next;
+  section *sec;
+  struct literal *first;
+  struct literal *last;
+};
+static struct litpool *litpools = NULL;
+
 
 
 operand *new_operand(void)
@@ -69,6 +83,103 @@ int cpu_available(int idx)
 }
 
 
+static int same_expr(expr *a,expr *b)
+/* returns true when both expression trees are identical */
+{
+  if (a==NULL || b==NULL)
+    return a == b;
+  if (a->type != b->type)
+    return 0;
+  if (a->type == NUM)
+    return a->c.val == b->c.val;
+  if (a->type == SYM)
+    return a->c.sym == b->c.sym;
+  if (a->type==HUG || a->type==FLT)
+    return 0;
+  return same_expr(a->left,b->left) && same_expr(a->right,b->right);
+}
+
+
+static symbol *new_literal(expr *value)
+/* Returns the label of a literal with this value in the current section's
+   pending pool. Creates a new pool entry, if required. */
+{
+  static unsigned long litcnt = 0;
+  section *sec = default_section();
+  struct litpool *pool;
+  struct literal *lit;
+  char litname[16];
+
+  for (pool=litpools; pool!=NULL; pool=pool->next) {
+    if (pool->sec == sec)
+      break;
+  }
+  if (pool == NULL) {
+    pool = mycalloc(sizeof(struct litpool));
+    pool->sec = sec;
+    pool->next = litpools;
+    litpools = pool;
+  }
+
+  for (lit=pool->first; lit!=NULL; lit=lit->next) {
+    if (same_expr(lit->value,value)) {
+      free_expr(value);
+      return lit->label;
+    }
+  }
+
+  lit = mymalloc(sizeof(struct literal));
+  lit->next = NULL;
+  lit->value = value;
+  sprintf(litname," *lit%09lu*",litcnt++);
+  lit->label = new_import(litname);
+  lit->label->flags |= VASMINTERN|PROTECTED;
+  if (pool->last)
+    pool->last->next = lit;
+  else
+    pool->first = lit;
+  pool->last = lit;
+  return lit->label;
+}
+
+
+static void flush_litpool(struct litpool *pool)
+/* place all pending literals of a pool at the end of its section */
+{
+  struct literal *lit,*next;
+  operand *op;
+  atom *a;
+
+  if (pool->first == NULL)
+    return;
+  a = new_space_atom(number_expr(0),1,NULL);
+  a->align = 4;
+  add_atom(pool->sec,a);
+
+  for (lit=pool->first; lit!=NULL; lit=next) {
+    next = lit->next;
+    new_labsym(pool->sec,lit->label->name);
+    add_atom(pool->sec,new_label_atom(lit->label));
+    op = new_operand();
+    op->type = DATA_OP;
+    op->value = lit->value;
+    add_atom(pool->sec,new_datadef_atom(32,op));
+    myfree(lit);
+  }
+  pool->first = pool->last = NULL;
+}
+
+
+void cpu_finish(void)
+/* place pending literal pools at the end of their sections */
+{
+  struct litpool *pool;
+
+  for (pool=litpools; pool!=NULL; pool=pool->next)
+    flush_litpool(pool);
+}
+
+
 char *parse_cpu_special(char *start)
 /* parse cpu-specific directives; return pointer to end of
    cpu-specific text */
@@ -91,6 +202,17 @@ char *parse_cpu_special(char *start)
         inst_alignment = 4;
       return s;
     }
+    else if ((s-name==6 && !strncmp(name,".ltorg",6)) ||
+             (s-name==5 && !strncmp(name,".pool",5))) {
+      section *sec = default_section();
+      struct litpool *pool;
+
+      for (pool=litpools; pool!=NULL; pool=pool->next) {
+        if (pool->sec == sec)
+          flush_litpool(pool);
+      }
+      return s;
+    }
   }
   return start;
 }
@@ -252,6 +374,22 @@ static int parse_reglist(char **pp)
 }
 
 
+#define ROTFAIL (0xffffff)
+
+static uint32_t rotated_immediate(uint32_t val)
+/* check if a 32-bit value can be represented as 8-bit-rotated,
+   return ROTFAIL when impossible */
+{
+  uint32_t i,a;
+
+  for (i=0; i<32; i+=2) {
+    if ((a = val<<i | val>>(32-i)) <= 0xff)
+      return (i<<7) | a;
+  }
+  return ROTFAIL;
+}
+
+
 int parse_operand(char *p,int len,operand *op,int optype)
 /* Parses operands, reads expressions and assigns relocation types */
 {
@@ -266,6 +404,30 @@ int parse_operand(char *p,int len,operand *op,int optype)
     op->value = parse_expr_huge(&p);
   }
 
+  else if (optype==PCLIT || optype==TPLIT) {
+    symbol *sym;
+
+    if (*p++ != '=' || thumb_mode != (optype==TPLIT))
+      return PO_NOMATCH;
+    p = skip(p);
+    op->value = parse_expr(&p);
+    if (skip(p)-start < len)
+      return PO_NOMATCH;
+
+    if (optype==PCLIT && op->value->type==NUM &&
+        (rotated_immediate(op->value->c.val)!=ROTFAIL ||
+         rotated_immediate(~op->value->c.val)!=ROTFAIL))
+      return PO_MATCH;  /* will be replaced by MOV or MVN */
+
+    /* load the value PC-relative from the literal pool */
+    sym = new_literal(op->value);
+    op->value = make_expr(SYM,NULL,NULL);
+    op->value->c.sym = sym;
+    op->type = optype==TPLIT ? TPCLW : PCL12;
+    op->flags |= OFL_LITERAL;
+    return PO_MATCH;
+  }
+
   else if (thumb_mode) {
     if (ARMOPER(optype)) {   /* standard ARM instruction */
       return PO_NOMATCH;
@@ -349,7 +511,7 @@ int parse_operand(char *p,int len,operand *op,int optype)
       char *q = p;
 
       /* check that this isn't any other valid operand */
-      if (*p=='#' || *p=='[' || *p=='{' || parse_reg(&q)>=0)
+      if (*p=='#' || *p=='[' || *p=='{' || *p=='=' || parse_reg(&q)>=0)
         return PO_NOMATCH;
       op->value = parse_expr(&p);
     }
@@ -630,6 +792,10 @@ size_t eval_thumb_operands(instruction *ip,section *sec,taddr pc,
             /* @@@ optimization makes any sense? */
             op.type = TUIMA;
             base = NULL;  /* no more checks */
+            if ((op.flags&OFL_LITERAL) && (val<0 || val>0x3fc) && insn) {
+              cpu_error(31,(long)val);  /* literal pool too far */
+              val = 0;
+            }
           }
         }
         else {
@@ -818,22 +984,6 @@ size_t eval_thumb_operands(instruction *ip,section *sec,taddr pc,
 }
 
 
-#define ROTFAIL (0xffffff)
-
-static uint32_t rotated_immediate(uint32_t val)
-/* check if a 32-bit value can be represented as 8-bit-rotated,
-   return ROTFAIL when impossible */
-{
-  uint32_t i,a;
-
-  for (i=0; i<32; i+=2) {
-    if ((a = val<<i | val>>(32-i)) <= 0xff)
-      return (i<<7) | a;
-  }
-  return ROTFAIL;
-}
-
-
 static int negated_rot_immediate(uint32_t val,mnemonic *mnemo,
                                  uint32_t *insn)
 /* check if negating the ALU-operation makes a valid 8-bit-rotated value,
@@ -1085,6 +1235,9 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
 
     /* do optimizations first */
 
+    if ((op.flags & OFL_LITERAL) && am != AM_NONE && insn)
+      cpu_error(18,addrmode_strings[am]);  /* illegal addr. mode */
+
     if (op.type==PCL12 || op.type==PCLRT ||
         op.type==PCLCP || op.type==BRA24) {
       /* PC-relative offsets (take prefetch into account: PC+8) */
@@ -1152,8 +1305,12 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
                 }
                 else {
                   op.type = NOOP;
-                  if (insn)
-                    cpu_error(4,val);  /* PC-relative ldr/str out of range */
+                  if (insn) {
+                    if (op.flags & OFL_LITERAL)
+                      cpu_error(31,(long)val);  /* literal pool too far */
+                    else
+                      cpu_error(4,val);  /* PC-relative ldr/str out of range */
+                  }
                 }
               }
               break;
@@ -1270,6 +1427,23 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
       }
     }
 
+    else if (op.type == PCLIT) {
+      /* constant fits into a MOV or MVN instruction */
+      op.type = NOOP;  /* is handled here */
+      if (insn) {
+        uint32_t rotval;
+
+        if (am != AM_NONE)
+          cpu_error(18,addrmode_strings[am]);  /* illegal addr. mode */
+        if ((rotval = rotated_immediate(val)) != ROTFAIL)
+          *insn = (*insn & 0xf000f000) | 0x03a00000 | rotval;
+        else if ((rotval = rotated_immediate(~val)) != ROTFAIL)
+          *insn = (*insn & 0xf000f000) | 0x03e00000 | rotval;
+        else
+          ierror(0);
+      }
+    }
+
     else if (op.type == IMROT) {
       op.type = NOOP;  /* is handled here */
 
@@ -1535,11 +1709,40 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
 }
 
 
+int arm_fixed_size(int code,operand **ops)
+/* Returns true when the instruction's size can never change. This is the
+   case when the mnemonic has no size-optimized operands, or when its only
+   variable operand is a rotated immediate with a constant value. */
+{
+  uint32_t flags = mnemonics[code].ext.flags;
+  int i;
+
+  if (flags & VARSIZE)
+    return 0;
+  if (flags & VARIMM) {
+    for (i=0; i<MAX_OPERANDS && ops[i]!=NULL; i++) {
+      if (ops[i]->type==IMROT && ops[i]->value->type!=NUM)
+        return 0;
+    }
+  }
+  return 1;
+}
+
+
 size_t instruction_size(instruction *ip,section *sec,taddr pc)
 /* Calculate the size of the current instruction; must be identical
    to the data created by eval_instruction. */
 {
-  if (mnemonics[ip->code].ext.flags & THUMB)
+  uint32_t flags = mnemonics[ip->code].ext.flags;
+
+  /* size of most instructions is known from the mnemonic table */
+  if (!(flags & (VARSIZE|VARIMM))) {
+    if (flags & THUMB)
+      return (flags & DBLINSN) ? 4 : 2;
+    return 4;
+  }
+
+  if (flags & THUMB)
     return eval_thumb_operands(ip,sec,pc,NULL,NULL);
 
   /* ARM mode */
@@ -1651,6 +1854,34 @@ dblock *eval_data(operand *op,size_t bitsize,section *sec,taddr pc)
 }
 
 
+static void set_size_flags(mnemonic *mnemo)
+/* determine whether the size of an instruction may be changed by
+   optimizations, or is fixed by the mnemonic table */
+{
+  int i;
+
+  for (i=0; i<MAX_OPERANDS; i++) {
+    switch (mnemo->operand_type[i]) {
+      case PCLRT:  /* ADR may become ADRL, ADRL may shrink to ADR */
+      case TBR08:  /* B<cc> out of range becomes B<!cc> .+4 ; B label */
+        mnemo->ext.flags |= VARSIZE;
+        break;
+      case PCL12:  /* LDR/STR Rd,label may become ADD/LDR */
+      case PCLIT:  /* LDR Rd,=expr from a literal pool, same as above */
+        if (opt_ldrpc)
+          mnemo->ext.flags |= VARSIZE;
+        break;
+      case IMROT:  /* immediate may need a second operation */
+        mnemo->ext.flags |= VARIMM;
+        break;
+      case TBRHL:  /* Thumb BL */
+        mnemo->ext.flags |= DBLINSN;
+        break;
+    }
+  }
+}
+
+
 int init_cpu()
 {
   char r[4];
@@ -1661,6 +1892,7 @@ int init_cpu()
       OC_SWP = i;
     else if (!strcmp(mnemonics[i].name,"nop"))
       OC_NOP = i;
+    set_size_flags(&mnemonics[i]);
   }
 
   if (!strcmp(output_format,"elf"))
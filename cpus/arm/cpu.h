@@ -33,6 +33,12 @@ typedef uint32_t utaddr;
 /* returns true when instruction is valid for selected cpu */
 #define MNEMONIC_VALID(i) cpu_available(i)
 
+/* cpu_finish() places all pending literal pools */
+#define HAVE_CPU_FINISH 1
+
+/* returns true when the instruction's size can never change */
+#define INST_SIZE_FIXED(ip) arm_fixed_size((ip)->code,(ip)->op)
+
 
 /* type to store each operand */
 typedef struct {
@@ -48,6 +54,7 @@ typedef struct {
 #define OFL_UP          (0x0010)  /* set up-flag, add offset to base */
 #define OFL_SPSR        (0x0020)  /* 1:SPSR, 0:CPSR */
 #define OFL_FORCE       (0x0040)  /* LDM/STM PSR & force user bit */
+#define OFL_LITERAL     (0x0080)  /* PC-relative reference to literal pool */
 
 
 /* operand types - WARNING: the order is important! See defines below. */
@@ -86,6 +93,7 @@ enum {
   CSPSR,      /* CPSR or SPSR */
   PSR_F,      /* PSR-field: SPSR_<field>, CPSR_<field> */
   RLIST,      /* register list */
+  PCLIT,      /* =Imm32 or =label, loaded PC-relative from literal pool */
 
   /* THUMB operands */
   TRG02,      /* Rn at 2..0 */
@@ -117,10 +125,11 @@ enum {
   TPCLW,      /* PC-relative label, has to fit into 10-bit uns.imm. >> 2 */
   TBR08,      /* 9-bit branch offset >> 1 to label at 7..0 */
   TBR11,      /* 12-bit branch offset >> 1 to label at 10..0 */
-  TBRHL       /* 23-bit branch offset >> 1 splitted into two 11-bit instr. */
+  TBRHL,      /* 23-bit branch offset >> 1 splitted into two 11-bit instr. */
+  TPLIT       /* =Imm32 or =label, loaded PC-relative from literal pool */
 };
 
-#define ARMOPER(x)    ((x)>=BRA24 && (x)<=RLIST)
+#define ARMOPER(x)    ((x)>=BRA24 && (x)<=PCLIT)
 #define STDOPER(x)    ((x)>=DATA_OP && (x)<=IMROT)
 #define CPOPCODE(x)   ((x)>=CPOP4 && (x)<=CPTYP)
 #define REGOPER(x)    ((x)>=REG03 && (x)<=R3UD2)
@@ -159,6 +168,9 @@ typedef struct {
 #define SETCC     (0x00000100)  /* instruction supports S-bit */
 #define SETPSR    (0x00000200)  /* instruction supports P-bit */
 #define THUMB     (0x10000000)  /* THUMB instruction */
+#define VARSIZE   (0x20000000)  /* size may change, set by init_cpu() */
+#define VARIMM    (0x40000000)  /* size depends on rotated immediate, dto. */
+#define DBLINSN   (0x80000000)  /* always two instructions, dto. */
 
 
 /* register symbols */
@@ -212,3 +224,4 @@ typedef struct {
 extern int arm_be_mode;
 
 int cpu_available(int);
+int arm_fixed_size(int,operand **);
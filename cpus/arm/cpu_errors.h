@@ -29,3 +29,4 @@
   "TSTP/TEQP/CMNP/CMPP deprecated on 32-bit architectures",WARNING,
   "rotate constant must be an even number between 0 and 30: %ld",ERROR,
   "%d-bit unsigned constant required: %ld",ERROR,                       /*30*/
+  "literal pool out of range (offset %ld), use .ltorg",ERROR,
@@ -89,11 +89,13 @@
   "ldr",    {REG15,R19PO,IMUD2},                  {0x04100000,AAANY,NOPCWB},
   "ldr",    {REG15,R19PO,R3UD2},                  {0x06100000,AAANY,NOPCWB|NOPCR03},
   "ldr",    {REG15,R19PO,R3UD2,SHIM2},            {0x06100000,AAANY,NOPCWB|NOPCR03},
+  "ldr",    {REG15,PCLIT},                        {0x051f0000,AAANY,NOPCWB},
     "ldr",  {TRG10,TPCLW},                        {0x4800,AA4TUP,THUMB},
     "ldr",  {TRG10,TPCPR,TUIAI},                  {0x4800,AA4TUP,THUMB},
     "ldr",  {TRG02,TR5IN,TR8IN},                  {0x5800,AA4TUP,THUMB},
     "ldr",  {TRG02,TR5IN,TUI7I},                  {0x6800,AA4TUP,THUMB},
     "ldr",  {TRG10,TSPPR,TUIAI},                  {0x9800,AA4TUP,THUMB},
+    "ldr",  {TRG10,TPLIT},                        {0x4800,AA4TUP,THUMB},
     "ldrb", {TRG02,TR5IN,TR8IN},                  {0x5c00,AA4TUP,THUMB},
     "ldrb", {TRG02,TR5IN,TUI5I},                  {0x7800,AA4TUP,THUMB},
     "ldrh", {TRG02,TR5IN,TR8IN},                  {0x5a00,AA4TUP,THUMB},
@@ -439,6 +439,20 @@ static int translate(instruction *p,section *sec,taddr pc)
   return c;
 }
 
+/* Returns true, if translate() will always choose the same mnemonic. */
+int c16x_fixed_size(int c,operand **op)
+{
+  if(c==JMP||(!notrans&&(c==JMPA||c==JMPR||c==JB||c==JNB)))
+    return 0;
+  if(mnemonics[c].operand_type[1]==OP_IMM3||
+     mnemonics[c].operand_type[1]==OP_IMM4){
+    if(op[1]->offset->type!=NUM&&
+       !strcmp(mnemonics[c].name,mnemonics[c+1].name))
+      return 0;
+  }
+  return 1;
+}
+
 /* Convert an instruction into a DATA atom including relocations,
    if necessary. */
 dblock *eval_instruction(instruction *p,section *sec,taddr pc)
@@ -74,6 +74,10 @@ typedef struct {
 #define MOD_DPP3 6
 #define MOD_DPPX 7
 
+/* returns true when the instruction's size can never change */
+#define INST_SIZE_FIXED(ip) c16x_fixed_size((ip)->code,(ip)->op)
+int c16x_fixed_size(int,operand **);
+
 #define CPU_C166 1
 #define CPU_C167 2
 #define CPU_ALL  (-1)
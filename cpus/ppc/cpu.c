@@ -23,6 +23,7 @@ static int regnames = 1;
 static taddr sdreg = 13;  /* this is default for V.4, PowerOpen = 2 */
 static taddr sd2reg = 2;
 static unsigned char opt_branch = 0;
+static unsigned char *varsize;  /* mnemonics which may change their size */
 
 
 
@@ -703,7 +704,7 @@ size_t instruction_size(instruction *ip,section *sec,taddr pc)
    to the data created by eval_instruction. */
 {
   /* determine optimized size, when needed */
-  if (opt_branch)
+  if (!ppc_fixed_size(ip->code))
     return eval_operands(ip,sec,pc,NULL,NULL);
 
   /* otherwise an instruction is always 4 bytes */
@@ -825,10 +826,41 @@ static void define_regnames(void)
 }
 
 
+static void set_size_flags(void)
+/* Only conditional branches, which may be converted into a B<!cc>,B
+   combination, can change their size. All other instructions are 4 bytes. */
+{
+  int i,j;
+
+  if (!opt_branch)
+    return;
+
+  varsize = mycalloc(mnemonic_cnt);
+  for (i=0; i<mnemonic_cnt; i++) {
+    for (j=0; j<MAX_OPERANDS; j++) {
+      int t = mnemonics[i].operand_type[j];
+
+      if (t==BD || t==BDM || t==BDP) {
+        varsize[i] = 1;
+        break;
+      }
+    }
+  }
+}
+
+
+int ppc_fixed_size(int code)
+/* true when the instruction size can never change */
+{
+  return varsize==NULL || !varsize[code];
+}
+
+
 int init_cpu()
 {
   if (regnames)
     define_regnames();
+  set_size_flags();
   return 1;
 }
 
@@ -34,6 +34,9 @@ typedef uint64_t utaddr;
 /* returns true when operand type is optional; may init default operand */
 #define OPERAND_OPTIONAL(p,t) ppc_operand_optional(p,t)
 
+/* returns true when the instruction's size can never change */
+#define INST_SIZE_FIXED(ip) ppc_fixed_size((ip)->code)
+
 /* special data operand types: */
 #define OP_D8  0x1001
 #define OP_D16 0x1002
@@ -262,3 +265,4 @@ int ppc_data_align(int);
 int ppc_data_operand(int);
 int ppc_available(int);
 int ppc_operand_optional(operand *,int);
+int ppc_fixed_size(int);
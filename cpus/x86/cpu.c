@@ -1733,6 +1733,39 @@ void init_instruction_ext(instruction_ext *ixp)
 }
 
 
+static int size_cache_hit(instruction *ip,section *sec,taddr pc)
+/* Returns true when the operand values, the pc and the optimization state
+   are the same as on the last size calculation. Otherwise they are
+   remembered for the next call. */
+{
+  instruction_ext *x = &ip->ext;
+  taddr val[MAX_OPERANDS];
+  int i,ok=0;
+
+  for (i=0; i<MAX_OPERANDS; i++) {
+    val[i] = 0;
+    if (ip->op[i]!=NULL && ip->op[i]->value!=NULL) {
+      if (eval_expr(ip->op[i]->value,&val[i],sec,pc))
+        ok |= 1<<i;
+    }
+  }
+
+  if ((x->flags & SIZE_CACHED) && x->cache_pc==pc && x->cache_ok==ok &&
+      x->cache_size==x->last_size &&
+      x->cache_flags==(x->flags & OPTFAILED) &&
+      !memcmp(x->cache_val,val,sizeof(val)))
+    return 1;
+
+  x->flags |= SIZE_CACHED;
+  x->cache_pc = pc;
+  x->cache_ok = ok;
+  x->cache_size = x->last_size;
+  x->cache_flags = x->flags & OPTFAILED;
+  memcpy(x->cache_val,val,sizeof(val));
+  return 0;
+}
+
+
 size_t instruction_size(instruction *realip,section *sec,taddr pc)
 /* Calculate the size of the current instruction; must be identical
    to the data created by eval_instruction. */
@@ -1771,6 +1804,10 @@ size_t instruction_size(instruction *realip,section *sec,taddr pc)
     }
   }
 
+  /* nothing to do, when no referenced label moved since the last pass */
+  if (size_cache_hit(realip,sec,pc))
+    return realip->ext.last_size;
+
   /* work on a copy of the current instruction and finalize it */
   size = finalize_instruction(copy_instruction(realip),sec,pc,0);
 
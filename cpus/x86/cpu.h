@@ -184,6 +184,12 @@ typedef struct {
   modrm_byte rm;
   sib_byte sib;
   short last_size;
+  /* operand values and state the cached last_size depends on */
+  unsigned char cache_ok;
+  unsigned char cache_flags;
+  short cache_size;
+  taddr cache_pc;
+  taddr cache_val[MAX_OPERANDS];
 } instruction_ext;
 
 /* flags: */
@@ -191,6 +197,7 @@ typedef struct {
 #define SUFFIX_CHECKED    0x2   /* suffix assigned and checked */
 #define MODRM_BYTE        0x4   /* needs mod/rm byte */
 #define SIB_BYTE          0x8   /* needs sib byte */
+#define SIZE_CACHED       0x10  /* last_size is valid for cache_xxx values */
 #define NEGOPT            0x40  /* negatively optimized, bytes gained */
 #define POSOPT            0x80  /* positively optimized, bytes gained */
 #define OPTFAILED         (POSOPT|NEGOPT)  /* no longer try to optimize this */
@@ -587,6 +587,15 @@ static int cpu_type = CPU_Z80;
 static int swapixiy = 0;
 static int rcmemu = 0;
 
+/* Optimizer options */
+static int opt_jr = 0;     /* jp/jp cc -> jr/jr cc, when in range */
+static int opt_speed = 0;  /* never use a form with more T-states */
+static int opt_flags = 0;  /* allow optimizations which modify the flags */
+
+/* Mnemonic indexes of jr, jr cc (set by init_cpu) */
+static int OC_JR = -1;
+static int OC_JRCC = -1;
+
 /* Variables set by special parsing */
 static int altd_enabled = 0;
 static int ioi_enabled = 0;
@@ -1234,11 +1243,77 @@ char *parse_cpu_special(char *start)
     return start;
 }
 
+/* Returns the mnemonic index of a jr/jr cc which can replace the jp/jp cc
+   instruction, or -1 when not possible. */
+static int jp_to_jr(instruction *ip, section *sec, taddr pc)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    operand  *op;
+    symbol   *base;
+    taddr     val;
+    int       jr;
+
+    if ( opt_jr == 0 || (cpu_type & CPU_8080) || (sec->flags & RESOLVE_WARN) ||
+         ip->ext.altd || ip->ext.ioi || ip->ext.ioe ) {
+        return -1;
+    }
+    if ( opcode->ext.mode == TYPE_NONE && opcode->ext.opcode == 0xc3 &&
+         opcode->operand_type[0] == OP_ABS16 ) {
+        op = ip->op[0];
+        jr = OC_JR;
+    } else if ( opcode->ext.mode == TYPE_FLAGS && opcode->ext.opcode == 0xc2 &&
+                opcode->operand_type[0] == OP_FLAGS &&
+                ip->op[0]->flags <= FLAGS_C ) {
+        op = ip->op[1];
+        jr = OC_JRCC;
+    } else {
+        return -1;
+    }
+
+    /* A taken jr needs more T-states than jp on the z80 (12 vs. 10) */
+    if ( opt_speed && (cpu_type & (CPU_Z180|CPU_GB80|CPU_RABBIT)) == 0 ) {
+        return -1;
+    }
+
+    /* Destination must be a label from the current section */
+    if ( eval_expr(op->value, &val, sec, pc) != 0 ||
+         find_base(op->value, &base, sec, pc) != BASE_OK ||
+         !LOCREF(base) || base->sec != sec ) {
+        return -1;
+    }
+    val -= pc + 2;
+    return ( val >= -128 && val <= 127 ) ? jr : -1;
+}
+
+/* Returns true when the instruction is ld a,0 and may be replaced by xor a */
+static int ld_a_0_to_xor(instruction *ip, section *sec, taddr pc)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    taddr     val;
+
+    if ( opt_flags == 0 || (cpu_type & CPU_RCM4000) ||
+         ip->ext.altd || ip->ext.ioi || ip->ext.ioe ) {
+        return 0;
+    }
+    return opcode->ext.mode == TYPE_MISC8 && opcode->ext.opcode == 0x06 &&
+           ip->op[0]->reg == REG_A &&
+           eval_expr(ip->op[1]->value, &val, sec, pc) != 0 && val == 0;
+}
+
+
 size_t instruction_size(instruction *ip, section *sec, taddr pc)
 {
     mnemonic *opcode = &mnemonics[ip->code];
     size_t    size;
 
+    /* Optimizations */
+    if ( jp_to_jr(ip, sec, pc) >= 0 ) {
+        return 2;
+    }
+    if ( ld_a_0_to_xor(ip, sec, pc) ) {
+        return 1;
+    }
+
     /* Try and find the right opcode as necessary */
     if ( (opcode->ext.cpus & cpu_type)  ) {
         int action = -1;
@@ -1682,6 +1757,32 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
     taddr val = 0;
     int   size = 0, reg,offs = 0; 
     int error = 0;
+    instruction jrinst;
+    operand jrops[MAX_OPERANDS];
+    int i, jr;
+
+    if ( (jr = jp_to_jr(ip, sec, pc)) >= 0 ) {
+        /* Continue with a jr copy of the instruction */
+        jrinst = *ip;
+        jrinst.code = jr;
+        for ( i = 0; i < MAX_OPERANDS; i++ ) {
+            if ( ip->op[i] != NULL ) {
+                jrops[i] = *ip->op[i];
+                if ( jrops[i].type == OP_ABS16 ) {
+                    jrops[i].type = OP_ABS;
+                }
+                jrinst.op[i] = &jrops[i];
+            }
+        }
+        ip = &jrinst;
+        opcode = &mnemonics[jr];
+    } else if ( ld_a_0_to_xor(ip, sec, pc) ) {
+        db = new_dblock();
+        db->size = 1;
+        db->data = mymalloc(db->size);
+        *db->data = 0xaf;  /* xor a */
+        return db;
+    }
 
     size = instruction_size(ip, sec, pc);
 
@@ -2056,6 +2157,14 @@ operand *new_operand()
 
 int init_cpu()
 {
+  int i;
+
+  for (i=0; i<mnemonic_cnt; i++) {
+    if (!strcmp(mnemonics[i].name,"jr") && mnemonics[i].ext.opcode==0x18)
+      OC_JR = i;
+    else if (!strcmp(mnemonics[i].name,"jr") && mnemonics[i].ext.opcode==0x20)
+      OC_JRCC = i;
+  }
   current_pc_char = '$';
   return 1;
 }
@@ -2097,6 +2206,15 @@ int cpu_args(char *p)
     } else if ( strcmp(p, "-z80asm" ) == 0 ) {
         z80asm_compat = 1;
         return 1;
+    } else if ( strcmp(p, "-opt-jr" ) == 0 ) {
+        opt_jr = 1;
+        return 1;
+    } else if ( strcmp(p, "-opt-speed" ) == 0 ) {
+        opt_speed = 1;
+        return 1;
+    } else if ( strcmp(p, "-opt-flags" ) == 0 ) {
+        opt_flags = 1;
+        return 1;
     }
     return 0;
 }
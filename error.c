@@ -25,7 +25,7 @@ struct err_out output_err_out[]={
 };
 int output_errors=sizeof(output_err_out)/sizeof(output_err_out[0]);
 
-int errors,warnings;
+int errors,warnings,messages;
 int max_errors=5;
 int no_warn;
 
@@ -131,8 +131,10 @@ static void error(int n,va_list vl,struct err_out *errlist,int offset)
     ++warnings;
     fprintf(f,"warning");
   }
-  else if (flags & MESSAGE)
+  else if (flags & MESSAGE) {
+    ++messages;
     fprintf(f,"message");
+  }
   fprintf(f," %d",n+offset);
   if (!(flags & NOLINE) && cur_src!=NULL) {
     fprintf(f," in line %d of ",cur_src->line);
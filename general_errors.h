@@ -73,3 +73,8 @@
   "undefined macro argument name",ERROR,
   "required macro argument %d was left out",ERROR,
   "label <%s> redefined",ERROR,
+  "cannot run server on socket <%s>",NOLINE|ERROR|FATAL,        /* 75 */
+  "atom size oscillates, fixed at its maximum (after <%s>)",WARNING,
+  "%lu more oscillating atoms in section <%s> fixed at their maximum",NOLINE|WARNING,
+  "resolver cycle of %d passes in section <%s>",NOLINE|WARNING,
+  "option %s is not allowed in a server request",NOLINE|ERROR,
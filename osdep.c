@@ -1,6 +1,7 @@
 /* osdep.c - OS-dependant routines */
 /* (c) in 2018 by Frank Wille */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,6 +13,14 @@ extern char *mystrdup(char *);
 
 #if defined(UNIX)
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 
 #elif defined(AMIGA)
 #include <dos/dos.h>
@@ -204,3 +213,200 @@ char *get_workdir(void)
   return "";
 }
 #endif
+
+
+/* time in microseconds for measurements, from an arbitrary start */
+#if defined(UNIX)
+unsigned long long get_usecs(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv,NULL);
+  return (unsigned long long)tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+#else  /* portable default, processor time */
+#include <time.h>
+unsigned long long get_usecs(void)
+{
+  return (unsigned long long)clock()*1000000/CLOCKS_PER_SEC;
+}
+#endif
+
+
+#if defined(UNIX)
+/* Assembler server on a Unix domain socket. A client sends the number of
+   strings, its stdout and stderr descriptors, and then the strings (work
+   directory and arguments), each as length and characters. The server
+   answers with the exit code. Every request is assembled by a child,
+   forked from the initialized server process. */
+
+static char *server_path;
+static int server_conn = -1;
+
+
+static void server_stop(int sig)
+{
+  unlink(server_path);
+  _exit(EXIT_SUCCESS);
+}
+
+
+static int server_read(int fd,void *buf,size_t n)
+{
+  char *p = buf;
+  ssize_t r;
+
+  while (n) {
+    if ((r = read(fd,p,n)) <= 0) {
+      if (r<0 && errno==EINTR)
+        continue;
+      return 0;
+    }
+    p += r;
+    n -= (size_t)r;
+  }
+  return 1;
+}
+
+
+static int server_request(int c,int *argc,char ***argv)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  union {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE(2*sizeof(int))];
+  } ctrl;
+  struct cmsghdr *cm;
+  uint32_t n,len;
+  int fds[2];
+  char **av,*cwd;
+  int i;
+
+  memset(&msg,0,sizeof(msg));
+  iov.iov_base = &n;
+  iov.iov_len = sizeof(n);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof(ctrl.buf);
+  if (recvmsg(c,&msg,0) != sizeof(n) || n<1 || n>0x10000)
+    return 0;
+  cm = CMSG_FIRSTHDR(&msg);
+  if (cm==NULL || cm->cmsg_level!=SOL_SOCKET || cm->cmsg_type!=SCM_RIGHTS ||
+      cm->cmsg_len!=CMSG_LEN(2*sizeof(int)))
+    return 0;
+  memcpy(fds,CMSG_DATA(cm),sizeof(fds));
+
+  /* the client's arguments follow the program name, the server's own
+     options were already processed */
+  av = mymalloc((n+1)*sizeof(char *));
+  av[0] = (*argv)[0];
+  for (i=1,cwd=NULL; n; n--) {
+    char *s;
+
+    if (!server_read(c,&len,sizeof(len)) || len>0x100000)
+      return 0;
+    s = mymalloc(len+1);
+    if (!server_read(c,s,len))
+      return 0;
+    s[len] = '\0';
+    if (cwd == NULL)
+      cwd = s;
+    else
+      av[i++] = s;
+  }
+  if (chdir(cwd)!=0 || dup2(fds[0],1)<0 || dup2(fds[1],2)<0)
+    return 0;
+  close(fds[0]);
+  close(fds[1]);
+  av[i] = NULL;
+  *argc = i;
+  *argv = av;
+  return 1;
+}
+
+
+int run_server(char *path,int workers,int *argc,char ***argv)
+{
+  struct sockaddr_un addr;
+  int fd,c,running=0;
+  pid_t pid;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+    return 0;
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,path);
+  if ((fd = socket(AF_UNIX,SOCK_STREAM,0)) < 0)
+    return 0;
+  if (connect(fd,(struct sockaddr *)&addr,sizeof(addr)) == 0) {
+    close(fd);  /* another server is using this socket */
+    return 0;
+  }
+  unlink(path);
+  if (bind(fd,(struct sockaddr *)&addr,sizeof(addr))<0 || listen(fd,64)<0) {
+    close(fd);
+    return 0;
+  }
+  server_path = path;
+  signal(SIGINT,server_stop);
+  signal(SIGTERM,server_stop);
+  signal(SIGHUP,server_stop);
+  if (workers <= 0)
+    workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (workers <= 0)
+    workers = 1;
+  fflush(NULL);
+
+  for (;;) {
+    while (running>0 && waitpid(-1,NULL,running<workers?WNOHANG:0)>0)
+      running--;
+    if ((c = accept(fd,NULL,NULL)) < 0) {
+      if (errno == EINTR)
+        continue;
+      unlink(path);
+      return 0;
+    }
+    if ((pid = fork()) == 0) {
+      close(fd);
+      signal(SIGINT,SIG_DFL);
+      signal(SIGTERM,SIG_DFL);
+      signal(SIGHUP,SIG_DFL);
+      if (!server_request(c,argc,argv))
+        _exit(EXIT_FAILURE);
+      server_conn = c;
+      return 1;
+    }
+    close(c);
+    if (pid > 0)
+      running++;
+  }
+}
+
+
+void server_exit(int rc)
+{
+  if (server_conn >= 0) {
+    int32_t n = rc;
+
+    fflush(stdout);
+    fflush(stderr);
+    write(server_conn,&n,sizeof(n));
+    close(server_conn);
+    server_conn = -1;
+  }
+}
+
+#else  /* no server */
+int run_server(char *path,int workers,int *argc,char ***argv)
+{
+  return 0;
+}
+
+
+void server_exit(int rc)
+{
+}
+#endif
@@ -12,3 +12,6 @@ char *append_path_delimiter(char *);
 char *remove_path_delimiter(char *);
 char *get_filepart(char *);
 char *get_workdir(void);
+unsigned long long get_usecs(void);
+int run_server(char *,int,int *,char ***);
+void server_exit(int);
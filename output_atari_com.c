@@ -6,18 +6,9 @@
 #ifdef OUTATARICOM
 static char *copyright="vasm atari com output module 1.8a (c) 2002-2009,2013,2015,2017 Volker Barthelmann";
 
-static int orgcmp(const void *sec1,const void *sec2)
-{
-  if (ULLTADDR((*(section **)sec1)->org) > ULLTADDR((*(section **)sec2)->org))
-    return 1;
-  if (ULLTADDR((*(section **)sec1)->org) < ULLTADDR((*(section **)sec2)->org))
-    return -1;
-  return 0;
-}
-
 static void write_output(FILE *f,section *sec,symbol *sym)
 {
-  section *s,*s2,**seclist,**slp;
+  section *s,**seclist,**slp;
   atom *p;
   size_t nsecs;
   unsigned long long pc,npc,i;
@@ -30,29 +21,13 @@ static void write_output(FILE *f,section *sec,symbol *sym)
       output_error(6,sym->name);  /* undefined symbol */
   }
 
-  /* we don't support overlapping sections */
-  for (s=sec,nsecs=0; s!=NULL; s=s->next) {
-    for (s2=s->next; s2; s2=s2->next) {
-      if (((ULLTADDR(s2->org) >= ULLTADDR(s->org) &&
-            ULLTADDR(s2->org) < ULLTADDR(s->pc)) ||
-           (ULLTADDR(s2->pc) > ULLTADDR(s->org) &&
-            ULLTADDR(s2->pc) <= ULLTADDR(s->pc))))
-        output_error(0);
-    }
-    nsecs++;
-  }
+  /* sections sorted by their start address, we don't support overlapping */
+  seclist = sort_sections(sec,&nsecs);
 
   /* write Atari DOS COM file header ($FFFF) */
   fw8(f, 0xff);
   fw8(f, 0xff);
 
-  /* make an array of section pointers, sorted by their start address */
-  seclist = (section **)mymalloc(nsecs * sizeof(section *));
-  for (s=sec,slp=seclist; s!=NULL; s=s->next)
-    *slp++ = s;
-  if (nsecs > 1)
-    qsort(seclist,nsecs,sizeof(section *),orgcmp);
-
   for (slp=seclist; nsecs>0; nsecs--) {
     s = *slp++;
     /* for each section start with load address 
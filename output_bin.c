@@ -9,24 +9,38 @@ static char *copyright="vasm binary output module 1.8a (c) 2002-2009,2013,2015,2
 #define BINFMT_RAW      0
 #define BINFMT_CBMPRG   1   /* Commodore VIC-20/C-64 PRG format */
 static int binfmt = BINFMT_RAW;
+static char *mapname;
 
 
-static int orgcmp(const void *sec1,const void *sec2)
+static void write_map(FILE *f,section **seclist,size_t nsecs,
+                      unsigned long long offs)
+/* write the address ranges of all sections and gaps in the output file */
 {
-  if (ULLTADDR((*(section **)sec1)->org) > ULLTADDR((*(section **)sec2)->org))
-    return 1;
-  if (ULLTADDR((*(section **)sec1)->org) < ULLTADDR((*(section **)sec2)->org))
-    return -1;
-  return 0;
+  unsigned long long pc=0,start,end;
+  size_t i;
+
+  fprintf(f,"Start    End      Size     Offset   Section\n");
+  for (i=0; i<nsecs; i++) {
+    start = ULLTADDR(seclist[i]->org);
+    end = ULLTADDR(seclist[i]->pc);
+    if (i>0 && start>pc) {
+      fprintf(f,"%08llx %08llx %08llx %08llx (gap)\n",
+              pc,start,start-pc,offs);
+      offs += start - pc;
+    }
+    fprintf(f,"%08llx %08llx %08llx %08llx %s\n",
+            start,end,end-start,offs,seclist[i]->name);
+    offs += end - start;
+    pc = end;
+  }
 }
 
 
 static void write_output(FILE *f,section *sec,symbol *sym)
 {
-  section *s,*s2,**seclist,**slp;
-  atom *p;
-  size_t nsecs;
-  unsigned long long pc,npc,i;
+  section *s,**seclist;
+  size_t nsecs,n;
+  unsigned long long pc=0,offs=0;
 
   if (!sec)
     return;
@@ -36,24 +50,8 @@ static void write_output(FILE *f,section *sec,symbol *sym)
       output_error(6,sym->name);  /* undefined symbol */
   }
 
-  /* we don't support overlapping sections */
-  for (s=sec,nsecs=0; s!=NULL; s=s->next) {
-    for (s2=s->next; s2; s2=s2->next) {
-      if (((ULLTADDR(s2->org) >= ULLTADDR(s->org) &&
-            ULLTADDR(s2->org) < ULLTADDR(s->pc)) ||
-           (ULLTADDR(s2->pc) > ULLTADDR(s->org) &&
-            ULLTADDR(s2->pc) <= ULLTADDR(s->pc))))
-        output_error(0);
-    }
-    nsecs++;
-  }
-
-  /* make an array of section pointers, sorted by their start address */
-  seclist = (section **)mymalloc(nsecs * sizeof(section *));
-  for (s=sec,slp=seclist; s!=NULL; s=s->next)
-    *slp++ = s;
-  if (nsecs > 1)
-    qsort(seclist,nsecs,sizeof(section *),orgcmp);
+  /* sections sorted by their start address, we don't support overlapping */
+  seclist = sort_sections(sec,&nsecs);
 
   if (binfmt == BINFMT_CBMPRG) {
     /* Commodore 6502 PRG header:
@@ -62,31 +60,31 @@ static void write_output(FILE *f,section *sec,symbol *sym)
      */
     fw8(f,sec->org&0xff);
     fw8(f,(sec->org>>8)&0xff);
+    offs = 2;
   }
 
-  for (slp=seclist; nsecs>0; nsecs--) {
-    s = *slp++;
-    if (s!=seclist[0] && ULLTADDR(s->org)>pc) {
+  for (n=0; n<nsecs; n++) {
+    s = seclist[n];
+    if (n>0 && ULLTADDR(s->org)>pc) {
       /* fill gap between sections with zeros */
-      for (; pc<ULLTADDR(s->org); pc++)
-        fw8(f,0);
+      fwspace(f,ULLTADDR(s->org)-pc);
     }
-    else
-      pc = ULLTADDR(s->org);
-
-    for (p=s->first; p; p=p->next) {
-      npc = ULLTADDR(fwpcalign(f,p,s,pc));
-      if (p->type == DATA) {
-        for (i=0; i<p->content.db->size; i++)
-          fw8(f,(unsigned char)p->content.db->data[i]);
-      }
-      else if (p->type == SPACE) {
-        fwsblock(f,p->content.sb);
-      }
-      pc = npc + atom_size(p,s,npc);
+    pc = ULLTADDR(s->org);
+
+    pc += fwsection(f,s,0);
+  }
+
+  if (mapname != NULL) {
+    FILE *mf;
+
+    if ((mf = fopen(mapname,"w")) != NULL) {
+      write_map(mf,seclist,nsecs,offs);
+      fclose(mf);
     }
+    else
+      output_error(16,mapname);  /* cannot open map file */
   }
-  free(seclist);
+  myfree(seclist);
 }
 
 
@@ -96,6 +94,10 @@ static int output_args(char *p)
     binfmt = BINFMT_CBMPRG;
     return 1;
   }
+  else if (!strncmp(p,"-map=",5)) {
+    mapname = p + 5;
+    return 1;
+  }
   return 0;
 }
 
@@ -13,7 +13,8 @@ static int be,cpu,bits;
 static unsigned elfrelsize,shtreloc;
 
 static hashtable *elfsymhash;
-static struct list shdrlist,symlist,relalist;
+static struct list shdrlist;
+static struct ElfTable symtab,symnames,reltab;
 static struct StrTabList shstrlist,strlist,stabstrlist;
 
 static unsigned symtabidx,strtabidx,shstrtabidx;
@@ -22,36 +23,153 @@ static unsigned stabidx,stabstralign;
 static utaddr stablen;
 static char stabname[] = ".stab";
 
+/* reference to a symbol name for building the tail-merged .strtab */
+struct strref {
+  char *s;
+  size_t len;
+  unsigned symidx;
+};
 
-static unsigned addString(struct StrTabList *sl,char *s)
+
+static void init_table(struct ElfTable *t,size_t entsize)
+{
+  t->data = NULL;
+  t->num = t->max = 0;
+  t->entsize = entsize;
+}
+
+
+static void *addEntry(struct ElfTable *t)
+/* append a cleared entry to the table and return a pointer to it */
+{
+  unsigned char *p;
+
+  if (t->num >= t->max) {
+    t->max = t->max ? t->max*2 : 64;
+    t->data = myrealloc(t->data,t->max*t->entsize);
+  }
+  p = t->data + t->num++ * t->entsize;
+  memset(p,0,t->entsize);
+  return p;
+}
+
+
+static void write_table(FILE *f,struct ElfTable *t)
+{
+  if (t->num)
+    fwdata(f,t->data,t->num*t->entsize);
+  myfree(t->data);
+  init_table(t,t->entsize);
+}
+
+
+static void init_strtab(struct StrTabList *sl)
+{
+  sl->buf = NULL;
+  sl->index = sl->max = 0;
+  sl->dups = new_hashtable(STRHTABSIZE);
+}
+
+
+static unsigned appendString(struct StrTabList *sl,char *s,size_t len)
 {
-  struct StrTabNode *sn = mymalloc(sizeof(struct StrTabNode));
   unsigned idx = sl->index;
 
-  sn->str = s;
-  addtail(&(sl->l),&(sn->n));
-  sl->index += (unsigned)strlen(s) + 1;
+  if (sl->index+len+1 > sl->max) {
+    sl->max = (sl->index+len+1) * 2;
+    sl->buf = myrealloc(sl->buf,sl->max);
+  }
+  memcpy(sl->buf+idx,s,len+1);
+  sl->index += (unsigned)len + 1;
   return idx;
 }
 
 
+static unsigned addString(struct StrTabList *sl,char *s)
+/* add a string, when not already present, and return its offset */
+{
+  hashdata data;
+
+  if (find_name(sl->dups,s,&data))
+    return data.idx;
+  data.idx = appendString(sl,s,strlen(s));
+  add_hashentry(sl->dups,s,data);
+  return data.idx;
+}
+
+
+static int cmp_strtail(const void *a,const void *b)
+/* compare reversed strings in descending order, so a string directly
+   follows the strings it is a suffix of */
+{
+  const struct strref *r1=a,*r2=b;
+  const char *p1=r1->s+r1->len,*p2=r2->s+r2->len;
+  int c;
+
+  while (p1>r1->s && p2>r2->s) {
+    if (c = (int)(unsigned char)*--p1 - (int)(unsigned char)*--p2)
+      return -c;
+  }
+  if (r1->len != r2->len)
+    return r1->len > r2->len ? -1 : 1;
+  return (int)r1->symidx - (int)r2->symidx;
+}
+
+
+static void build_symstrtab(void)
+/* Put all symbol names into .strtab and set their st_name. Names which
+   are the tail of another name share the same characters. */
+{
+  struct strref *refs = mymalloc(symindex*sizeof(struct strref) + 1);
+  unsigned i,n,off,prevoff=0;
+  struct strref *prev = NULL;
+
+  for (i=0,n=0; i<symindex; i++) {
+    char *name = ((char **)symnames.data)[i];
+
+    if (name != NULL) {
+      refs[n].s = name;
+      refs[n].len = strlen(name);
+      refs[n++].symidx = i;
+    }
+  }
+  qsort(refs,n,sizeof(struct strref),cmp_strtail);
+
+  for (i=0; i<n; i++) {
+    struct strref *r = &refs[i];
+
+    if (prev!=NULL && prev->len>=r->len &&
+        !memcmp(prev->s+prev->len-r->len,r->s,r->len))
+      off = prevoff + (unsigned)(prev->len - r->len);
+    else {
+      prevoff = off = appendString(&strlist,r->s,r->len);
+      prev = r;
+    }
+    /* st_name is the first field of Elf32_Sym and Elf64_Sym */
+    setval(be,symtab.data+r->symidx*symtab.entsize,4,off);
+  }
+  myfree(refs);
+  myfree(symnames.data);
+  init_table(&symnames,sizeof(char *));
+}
+
+
 static void init_lists(void)
 {
   elfsymhash = new_hashtable(ELFSYMHTABSIZE);
   initlist(&shdrlist);
-  initlist(&symlist);
-  initlist(&relalist);
-  shstrlist.index = strlist.index = 0;
-  initlist(&shstrlist.l);
-  initlist(&strlist.l);
+  init_table(&symnames,sizeof(char *));
+  init_table(&reltab,elfrelsize);
+  init_strtab(&shstrlist);
+  init_strtab(&strlist);
   symindex = shdrindex = stabidx = 0;
   addString(&shstrlist,emptystr);  /* first string is always "" */
   symtabidx = addString(&shstrlist,".symtab");
   strtabidx = addString(&shstrlist,".strtab");
   shstrtabidx = addString(&shstrlist,".shstrtab");
-  addString(&strlist,emptystr);
+  appendString(&strlist,emptystr,0);
   if (!no_symbols && first_nlist) {
-    initlist(&stabstrlist.l);
+    init_strtab(&stabstrlist);
     addString(&stabstrlist,emptystr);
   }
 }
@@ -77,80 +195,56 @@ static struct Shdr64Node *addShdr64(void)
 }
 
 
-static struct Symbol32Node *addSymbol32(char *name)
+static void *addSymbol(char *name)
+/* append a new symbol, its name is put into .strtab later */
 {
-  struct Symbol32Node *sn = mycalloc(sizeof(struct Symbol32Node));
   hashdata data;
 
-  addtail(&symlist,&(sn->n));
-  if (name) {
-    sn->name = name;
-    setval(be,sn->s.st_name,4,addString(&strlist,name));
-  }
-  data.ptr = sn;
-  sn->idx = symindex++;
+  *(char **)addEntry(&symnames) = name;
+  data.idx = symindex++;
   add_hashentry(elfsymhash,name?name:emptystr,data);
-  return sn;
-}
-
-
-static struct Symbol64Node *addSymbol64(char *name)
-{
-  struct Symbol64Node *sn = mycalloc(sizeof(struct Symbol64Node));
-  hashdata data;
-
-  addtail(&symlist,&(sn->n));
-  if (name) {
-    sn->name = name;
-    setval(be,sn->s.st_name,4,addString(&strlist,name));
-  }
-  data.ptr = sn;
-  sn->idx = symindex++;
-  add_hashentry(elfsymhash,name?name:emptystr,data);
-  return sn;
+  return addEntry(&symtab);
 }
 
 
 static void newSym32(char *name,elfull value,elfull size,uint8_t bind,
                      uint8_t type,unsigned shndx)
 {
-  struct Symbol32Node *elfsym = addSymbol32(name);
+  struct Elf32_Sym *elfsym = addSymbol(name);
 
-  setval(be,elfsym->s.st_value,4,value);
-  setval(be,elfsym->s.st_size,4,size);
-  elfsym->s.st_info[0] = ELF32_ST_INFO(bind,type);
-  setval(be,elfsym->s.st_shndx,2,shndx);
+  setval(be,elfsym->st_value,4,value);
+  setval(be,elfsym->st_size,4,size);
+  elfsym->st_info[0] = ELF32_ST_INFO(bind,type);
+  setval(be,elfsym->st_shndx,2,shndx);
 }
 
 
 static void newSym64(char *name,elfull value,elfull size,uint8_t bind,
                      uint8_t type,unsigned shndx)
 {
-  struct Symbol64Node *elfsym = addSymbol64(name);
+  struct Elf64_Sym *elfsym = addSymbol(name);
 
-  setval(be,elfsym->s.st_value,8,value);
-  setval(be,elfsym->s.st_size,8,size);
-  elfsym->s.st_info[0] = ELF64_ST_INFO(bind,type);
-  setval(be,elfsym->s.st_shndx,2,shndx);
+  setval(be,elfsym->st_value,8,value);
+  setval(be,elfsym->st_size,8,size);
+  elfsym->st_info[0] = ELF64_ST_INFO(bind,type);
+  setval(be,elfsym->st_shndx,2,shndx);
 }
 
 
 static void addRel32(elfull o,elfull a,elfull i,elfull r)
 {
   if (RELA) {
-    struct Rela32Node *rn = mymalloc(sizeof(struct Rela32Node));
+    struct Elf32_Rela *rn = addEntry(&reltab);
 
-    setval(be,rn->r.r_offset,4,o);
-    setval(be,rn->r.r_addend,4,a);
-    setval(be,rn->r.r_info,4,ELF32_R_INFO(i,r));
-    addtail(&relalist,&(rn->n));
+    setval(be,rn->r_offset,4,o);
+    setval(be,rn->r_addend,4,a);
+    setval(be,rn->r_info,4,ELF32_R_INFO(i,r));
   }
   else {
-    struct Rel32Node *rn = mymalloc(sizeof(struct Rel32Node));
+    struct Elf32_Rel *rn = addEntry(&reltab);
 
-    setval(be,rn->r.r_offset,4,o);
-    setval(be,rn->r.r_info,4,ELF32_R_INFO(i,r));
-    addtail(&relalist,&(rn->n));
+    setval(be,rn->r_offset,4,o);
+    setval(be,rn->r_info,4,ELF32_R_INFO(i,r));
   }
 }
 
@@ -158,19 +252,17 @@ static void addRel32(elfull o,elfull a,elfull i,elfull r)
 static void addRel64(elfull o,elfull a,elfull i,elfull r)
 {
   if (RELA) {
-    struct Rela64Node *rn = mymalloc(sizeof(struct Rela64Node));
+    struct Elf64_Rela *rn = addEntry(&reltab);
 
-    setval(be,rn->r.r_offset,8,o);
-    setval(be,rn->r.r_addend,8,a);
-    setval(be,rn->r.r_info,8,ELF64_R_INFO(i,r));
-    addtail(&relalist,&(rn->n));
+    setval(be,rn->r_offset,8,o);
+    setval(be,rn->r_addend,8,a);
+    setval(be,rn->r_info,8,ELF64_R_INFO(i,r));
   }
   else {
-    struct Rel64Node *rn = mymalloc(sizeof(struct Rel64Node));
+    struct Elf64_Rel *rn = addEntry(&reltab);
 
-    setval(be,rn->r.r_offset,8,o);
-    setval(be,rn->r.r_info,8,ELF64_R_INFO(i,r));
-    addtail(&relalist,&(rn->n));
+    setval(be,rn->r_offset,8,o);
+    setval(be,rn->r_info,8,ELF64_R_INFO(i,r));
   }
 }
 
@@ -214,12 +306,12 @@ static void *makeShdr64(elfull name,elfull type,elfull flags,elfull offset,
 
 
 static unsigned findelfsymbol(char *name)
-/* find symbol with given name in symlist, return its index */
+/* find symbol with given name in symtab, return its index */
 {
   hashdata data;
 
   if (find_name(elfsymhash,name,&data))
-    return ((struct Symbol32Node *)data.ptr)->idx;
+    return data.idx;
   return 0;
 }
 
@@ -602,10 +694,13 @@ static void make_reloc_sections(section *sec,
 
 static void write_strtab(FILE *f,struct StrTabList *strl)
 {
-  struct StrTabNode *stn;
-
-  while (stn = (struct StrTabNode *)remhead(&(strl->l)))
-    fwdata(f,stn->str,strlen(stn->str)+1);
+  if (strl->index)
+    fwdata(f,strl->buf,strl->index);
+  myfree(strl->buf);
+  strl->buf = NULL;
+  strl->index = strl->max = 0;
+  free_hashtable(strl->dups);
+  strl->dups = NULL;
 }
 
 
@@ -615,23 +710,8 @@ static void write_section_data(FILE *f,section *sec)
   section *secp;
 
   for (secp=sec; secp; secp=secp->next) {
-    if (secp->idx && get_sec_type(secp)!=SHT_NOBITS) {
-      atom *a;
-      utaddr pc=0,npc;
-
-      for (a=secp->first; a; a=a->next) {
-        npc = fwpcalign(f,a,secp,pc);
-
-        if (a->type == DATA) {
-          fwdata(f,a->content.db->data,a->content.db->size);
-        }
-        else if (a->type == SPACE) {
-          fwsblock(f,a->content.sb);
-        }
-
-        pc = npc + atom_size(a,secp,npc);
-      }
-    }
+    if (secp->idx && get_sec_type(secp)!=SHT_NOBITS)
+      fwsection(f,secp,0);
   }
 
   if (!no_symbols && nlist!=NULL) {
@@ -664,7 +744,6 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
   unsigned firstglobal,align1,align2,i;
   utaddr soffset=sizeof(struct Elf64_Ehdr);
   struct Shdr64Node *shn;
-  struct Symbol64Node *elfsym;
 
   elfrelsize = RELA ? sizeof(struct Elf64_Rela) : sizeof(struct Elf64_Rel);
 
@@ -678,13 +757,15 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
   setval(be,header.e_shentsize,2,sizeof(struct Elf64_Shdr));
 
   init_lists();
-  addShdr64();        /* first section header is always zero */
-  addSymbol64(NULL);  /* first symbol is empty */
+  init_table(&symtab,sizeof(struct Elf64_Sym));
+  addShdr64();      /* first section header is always zero */
+  addSymbol(NULL);  /* first symbol is empty */
 
   /* make program section headers, symbols and relocations */
   soffset = prog_sec_hdrs(sec,soffset,makeShdr64,newSym64);
   firstglobal = build_symbol_table(sym,newSym64);
   make_reloc_sections(sec,newSym64,addRel64,makeShdr64);
+  build_symstrtab();
 
   /* ".shstrtab" section header string table */
   makeShdr64(shstrtabidx,SHT_STRTAB,0,
@@ -735,26 +816,14 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
   }
 
   /* write symbol table */
-  while (elfsym = (struct Symbol64Node *)remhead(&symlist))
-    fwdata(f,&(elfsym->s),sizeof(struct Elf64_Sym));
+  write_table(f,&symtab);
 
   /* write .strtab string table */
   write_strtab(f,&strlist);
 
   /* write relocations */
   fwspace(f,align2);
-  if (RELA) {
-    struct Rela64Node *rn;
-
-    while (rn = (struct Rela64Node *)remhead(&relalist))
-      fwdata(f,&(rn->r),sizeof(struct Elf64_Rela));
-  }
-  else {
-    struct Rel64Node *rn;
-
-    while (rn = (struct Rel64Node *)remhead(&relalist))
-      fwdata(f,&(rn->r),sizeof(struct Elf64_Rel));
-  }
+  write_table(f,&reltab);
 }
 
 
@@ -764,7 +833,6 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
   unsigned firstglobal,align1,align2,i;
   utaddr soffset=sizeof(struct Elf32_Ehdr);
   struct Shdr32Node *shn;
-  struct Symbol32Node *elfsym;
 
   elfrelsize = RELA ? sizeof(struct Elf32_Rela) : sizeof(struct Elf32_Rel);
 
@@ -781,13 +849,15 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
   setval(be,header.e_shentsize,2,sizeof(struct Elf32_Shdr));
 
   init_lists();
-  addShdr32();        /* first section header is always zero */
-  addSymbol32(NULL);  /* first symbol is empty */
+  init_table(&symtab,sizeof(struct Elf32_Sym));
+  addShdr32();      /* first section header is always zero */
+  addSymbol(NULL);  /* first symbol is empty */
 
   /* make program section headers, symbols and relocations */
   soffset = prog_sec_hdrs(sec,soffset,makeShdr32,newSym32);
   firstglobal = build_symbol_table(sym,newSym32);
   make_reloc_sections(sec,newSym32,addRel32,makeShdr32);
+  build_symstrtab();
 
   /* ".shstrtab" section header string table */
   makeShdr32(shstrtabidx,SHT_STRTAB,0,
@@ -838,26 +908,14 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
   }
 
   /* write symbol table */
-  while (elfsym = (struct Symbol32Node *)remhead(&symlist))
-    fwdata(f,&(elfsym->s),sizeof(struct Elf32_Sym));
+  write_table(f,&symtab);
 
   /* write .strtab string table */
   write_strtab(f,&strlist);
 
   /* write relocations */
   fwspace(f,align2);
-  if (RELA) {
-    struct Rela32Node *rn;
-
-    while (rn = (struct Rela32Node *)remhead(&relalist))
-      fwdata(f,&(rn->r),sizeof(struct Elf32_Rela));
-  }
-  else {
-    struct Rel32Node *rn;
-
-    while (rn = (struct Rel32Node *)remhead(&relalist))
-      fwdata(f,&(rn->r),sizeof(struct Elf32_Rel));
-  }
+  write_table(f,&reltab);
 }
 
 
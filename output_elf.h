@@ -243,13 +243,18 @@ struct Elf64_Rela {
 typedef uint64_t elfull;
 
 struct StrTabList {
-  struct list l;
-  unsigned index;
+  char *buf;        /* contiguous string table */
+  unsigned index;   /* current size of the table */
+  unsigned max;     /* allocated size */
+  hashtable *dups;  /* offsets of already added strings */
 };
 
-struct StrTabNode {
-  struct node n;
-  char *str;
+/* growable array of ELF symbols or relocations */
+struct ElfTable {
+  unsigned char *data;
+  unsigned num;
+  unsigned max;
+  size_t entsize;
 };
 
 struct Shdr32Node {
@@ -257,45 +262,11 @@ struct Shdr32Node {
   struct Elf32_Shdr s;
 };
 
-struct Symbol32Node {
-  struct node n;
-  char *name;
-  unsigned idx;
-  struct Elf32_Sym s;
-};
-
-struct Rela32Node {
-  struct node n;
-  struct Elf32_Rela r;
-};
-
-struct Rel32Node {
-  struct node n;
-  struct Elf32_Rel r;
-};
-
 struct Shdr64Node {
   struct node n;
   struct Elf64_Shdr s;
 };
 
-struct Symbol64Node {
-  struct node n;
-  char *name;
-  unsigned idx;
-  struct Elf64_Sym s;
-};
-
-struct Rela64Node {
-  struct node n;
-  struct Elf64_Rela r;
-};
-
-struct Rel64Node {
-  struct node n;
-  struct Elf64_Rel r;
-};
-
 
 #if defined(VASM_CPU_M68K)
 #define RELA 1
@@ -317,3 +288,4 @@ struct Rel64Node {
 #endif
 
 #define ELFSYMHTABSIZE 0x10000
+#define STRHTABSIZE 0x1000
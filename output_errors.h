@@ -12,3 +12,6 @@
   "address 0x%llx out of range for selected format",ERROR|NOLINE,
   "reloc type %d, mask 0x%lx to symbol %s + 0x%lx does not fit into %u bits",ERROR,
   "data definition following a databss space directive",WARNING,
+  "record length %d exceeds maximum of %d for selected format",WARNING|NOLINE,
+  "section <%s> (0x%llx-0x%llx) overlaps with section <%s> (0x%llx-0x%llx)",FATAL|ERROR|NOLINE,
+  "cannot open map file <%s>",ERROR|NOLINE,
@@ -293,24 +293,22 @@ static utaddr sect_size(section *sec)
 }
 
 
-static struct hunkreloc *convert_reloc(rlist *rl,utaddr pc)
+static uint32_t convert_reloc(secreloc *r,struct hunkreloc *hr,uint32_t *idx)
+/* returns hunk relocation type and fills in hr and the target hunk index,
+   or returns 0 when the relocation is not supported */
 {
-  nreloc *r = (nreloc *)rl->reloc;
-
-  if (rl->type <= LAST_STANDARD_RELOC
+  if (r->type <= LAST_STANDARD_RELOC
 #if defined(VASM_CPU_PPC)
-      || rl->type==REL_PPCEABI_SDA2
+      || r->type==REL_PPCEABI_SDA2
 #endif
      ) {
     if (LOCREF(r->sym)) {
-      struct hunkreloc *hr;
       uint32_t type;
-      uint32_t offs = pc + r->byteoffset;
 
-      switch (rl->type) {
+      switch (r->type) {
         case REL_ABS:
           if (r->size!=32 || r->bitoffset!=0 || r->mask!=-1)
-            return NULL;
+            return 0;
           type = HUNK_ABSRELOC32;
           break;
 
@@ -318,33 +316,35 @@ static struct hunkreloc *convert_reloc(rlist *rl,utaddr pc)
           switch (r->size) {
             case 8:
               if (r->bitoffset!=0 || r->mask!=-1)
-                return NULL;
+                return 0;
               type = HUNK_RELRELOC8;
               break;
 #if defined(VASM_CPU_PPC)
             case 14:
               if (r->bitoffset!=0 || r->mask!=0xfffc)
-                return NULL;
+                return 0;
               type = HUNK_RELRELOC16;
               break;
 #endif
             case 16:
               if (r->bitoffset!=0 || r->mask!=-1)
-                return NULL;
+                return 0;
               type = HUNK_RELRELOC16;
               break;
 #if defined(VASM_CPU_PPC)
             case 24:
               if (r->bitoffset!=6 || r->mask!=0x3fffffc)
-                return NULL;
+                return 0;
               type = HUNK_RELRELOC26;
               break;
 #endif
             case 32:
               if (kick1 || r->bitoffset!=0 || r->mask!=-1)
-                return NULL;
+                return 0;
               type = HUNK_RELRELOC32;
               break;
+            default:
+              return 0;
           }
           break;
 
@@ -353,43 +353,38 @@ static struct hunkreloc *convert_reloc(rlist *rl,utaddr pc)
 #endif
         case REL_SD:
           if (r->size!=16 || r->bitoffset!=0 || r->mask!=-1)
-            return NULL;
+            return 0;
           type = HUNK_DREL16;
           break;
 
         default:
-          return NULL;
+          return 0;
       }
 
-      hr = mymalloc(sizeof(struct hunkreloc));
-      hr->rl = rl;
-      hr->hunk_id = type;
-      hr->hunk_offset = offs;
-      hr->hunk_index = r->sym->sec->idx;
-      return hr;
+      hr->rl = r->rl;
+      hr->hunk_offset = r->offset;
+      *idx = r->sym->sec->idx;
+      return type;
     }
   }
 
-  return NULL;
+  return 0;
 }
 
 
-static struct hunkxref *convert_xref(rlist *rl,utaddr pc)
+static struct hunkxref *convert_xref(secreloc *r)
 {
-  nreloc *r = (nreloc *)rl->reloc;
-
-  if (rl->type <= LAST_STANDARD_RELOC
+  if (r->type <= LAST_STANDARD_RELOC
 #if defined(VASM_CPU_PPC)
-      || rl->type==REL_PPCEABI_SDA2
+      || r->type==REL_PPCEABI_SDA2
 #endif
      ) {
     if (EXTREF(r->sym)) {
       struct hunkxref *xref;
       uint32_t type,size=0;
-      uint32_t offs = pc + r->byteoffset;
       int com = (r->sym->flags & COMMON) != 0;
 
-      switch (rl->type) {
+      switch (r->type) {
         case REL_ABS:
           if (r->bitoffset!=0 || r->mask!=-1 || (com && r->size!=32))
             return NULL;
@@ -467,7 +462,7 @@ static struct hunkxref *convert_xref(rlist *rl,utaddr pc)
       xref->name = r->sym->name;
       xref->type = type;
       xref->size = size;
-      xref->offset = offs;
+      xref->offset = r->offset;
       return xref;
     }
   }
@@ -476,103 +471,175 @@ static struct hunkxref *convert_xref(rlist *rl,utaddr pc)
 }
 
 
-static void process_relocs(atom *a,struct list *reloclist,
-                           struct list *xreflist,section *sec,utaddr pc)
-/* convert an atom's rlist into relocations and xrefs */
+static uint32_t relhash(uint32_t type,uint32_t idx,uint32_t hsize)
 {
-  rlist *rl;
+  return (type*0x9e3779b1 ^ idx*0x85ebca6b) & (hsize-1);
+}
+
+
+static struct hunkrelbucket *reloc_bucket(struct hunkreltab *rt,
+                                          uint32_t type,uint32_t idx)
+/* return bucket for relocations of one type into hunk idx, which is
+   created when missing */
+{
+  struct hunkrelbucket *b;
+  uint32_t h=0,i;
+
+  if (rt->hsize) {
+    for (h=relhash(type,idx,rt->hsize); (i=rt->hash[h])!=0;
+         h=(h+1)&(rt->hsize-1)) {
+      b = &rt->b[i-1];
+      if (b->type==type && b->idx==idx)
+        return b;
+    }
+  }
 
-  if (a->type == DATA)
-    rl = a->content.db->relocs;
-  else if (a->type == SPACE)
-    rl = a->content.sb->relocs;
+  if (rt->n >= rt->max) {
+    rt->max = rt->max ? rt->max*2 : 8;
+    rt->b = myrealloc(rt->b,rt->max*sizeof(struct hunkrelbucket));
+  }
+  b = &rt->b[rt->n++];
+  memset(b,0,sizeof(struct hunkrelbucket));
+  b->type = type;
+  b->idx = idx;
+
+  if (rt->n*2 > rt->hsize) {
+    /* grow and rebuild the hash index */
+    myfree(rt->hash);
+    rt->hsize = rt->hsize ? rt->hsize*2 : 16;
+    rt->hash = mycalloc(rt->hsize*sizeof(uint32_t));
+    for (i=0; i<rt->n; i++) {
+      for (h=relhash(rt->b[i].type,rt->b[i].idx,rt->hsize); rt->hash[h];
+           h=(h+1)&(rt->hsize-1));
+      rt->hash[h] = i + 1;
+    }
+  }
   else
-    return;
+    rt->hash[h] = rt->n;
+  return b;
+}
+
 
-  if (rl == NULL)
-    return;
+static void init_reloctab(struct hunkreltab *rt)
+{
+  rt->b = NULL;
+  rt->n = rt->max = 0;
+  rt->hash = NULL;
+  rt->hsize = 0;
+}
 
-  do {
-    struct hunkreloc *hr = convert_reloc(rl,pc);
 
-    if (hr!=NULL && (xreflist!=NULL || hr->hunk_id==HUNK_ABSRELOC32 ||
-                     hr->hunk_id==HUNK_RELRELOC32)) {
-      addtail(reloclist,&hr->n);       /* add new relocation */
+static void free_reloctab(struct hunkreltab *rt)
+{
+  uint32_t i;
+
+  for (i=0; i<rt->n; i++)
+    myfree(rt->b[i].r);
+  myfree(rt->b);
+  myfree(rt->hash);
+  init_reloctab(rt);
+}
+
+
+static void add_reloc(struct hunkrelbucket *b,struct hunkreloc *hr)
+{
+  if (b->n >= b->max) {
+    b->max = b->max ? b->max*2 : 16;
+    b->r = myrealloc(b->r,b->max*sizeof(struct hunkreloc));
+  }
+  b->r[b->n++] = *hr;
+  if (hr->hunk_offset > b->maxoffs)
+    b->maxoffs = hr->hunk_offset;
+}
+
+
+static void process_relocs(section *sec,struct hunkreltab *reltab,
+                           struct list *xreflist)
+/* convert the section's relocations into hunk relocations and xrefs */
+{
+  struct hunkreloc hr;
+  uint32_t type,idx;
+  secreloc *rels,*r;
+  size_t n;
+
+  for (r=rels=collect_relocs(sec,&n); n>0; n--,r++) {
+    type = convert_reloc(r,&hr,&idx);
+
+    if (type!=0 && idx<sec_cnt && (xreflist!=NULL ||
+                                   type==HUNK_ABSRELOC32 ||
+                                   type==HUNK_RELRELOC32)) {
+      /* add new relocation */
+      add_reloc(reloc_bucket(reltab,type,idx),&hr);
     }
     else {
-      struct hunkxref *xref = convert_xref(rl,pc);
+      struct hunkxref *xref = convert_xref(r);
 
       if (xref) {
         if (xreflist)
           addtail(xreflist,&xref->n);  /* add new external reference */
         else
-          output_atom_error(8,a,xref->name,sec->name,xref->offset,rl->type);
+          output_atom_error(8,r->a,xref->name,sec->name,xref->offset,r->type);
       }
       else
-        unsupp_reloc_error(rl);  /* reloc not supported */
+        unsupp_reloc_error(r->rl);  /* reloc not supported */
     }
   }
-  while (rl = rl->next);
+  myfree(rels);
 }
 
 
-static void reloc_hunk(FILE *f,uint32_t type,int shrt,struct list *reloclist)
+static int cmp_bucket(const void *a,const void *b)
+{
+  uint32_t i1 = (*(struct hunkrelbucket **)a)->idx;
+  uint32_t i2 = (*(struct hunkrelbucket **)b)->idx;
+
+  return i1<i2 ? -1 : (i1>i2 ? 1 : 0);
+}
+
+
+static void reloc_hunk(FILE *f,uint32_t type,int shrt,struct hunkreltab *rt)
 /* write all section-offsets for one relocation type */
 {
+  struct hunkrelbucket **bl,*b;
   int bytes = 0;
-  uint32_t idx;
+  uint32_t i,j,n;
 
-  for (idx=0; idx<sec_cnt; idx++) {
-    struct hunkreloc *r,*next;
-    uint32_t n;
-    int off16;
+  /* buckets of this type, in order of their target hunks */
+  bl = mymalloc((rt->n+1)*sizeof(struct hunkrelbucket *));
+  for (i=n=0; i<rt->n; i++) {
+    if (rt->b[i].type==type && rt->b[i].n!=0)
+      bl[n++] = &rt->b[i];
+  }
+  qsort(bl,n,sizeof(struct hunkrelbucket *),cmp_bucket);
 
-    for (r=(struct hunkreloc *)reloclist->first,n=0,off16=1;
-         r->n.next; r=(struct hunkreloc *)r->n.next) {
-      if (r->hunk_id==type && r->hunk_index==idx) {
-        n++;
-        if (r->hunk_offset >= 0x10000)
-          off16 = 0;
-      }
-    }
-    if (shrt && (n>=0x10000 || off16==0))
+  for (j=0; j<n; j++) {
+    b = bl[j];
+    if (shrt && (b->n>=0x10000 || b->maxoffs>=0x10000))
       continue;  /* relocs for this hunk don't fit into 16-bit entries */
-    if (n > 0) {
-      if (bytes == 0) {
-        if (shrt && type==HUNK_ABSRELOC32)
-          fw32(f,HUNK_DREL32,1);  /* RELOC32SHORT is DREL32 for OS2.0 */
-        else
-          fw32(f,type,1);
-        bytes = 4;
-      }
-      if (shrt) {
-        fw16(f,n,1);
-        fw16(f,idx,1);
-        bytes += 4;
-      }
-      else {
-        fw32(f,n,1);
-        fw32(f,idx,1);
-        bytes += 8;
-      }
-      r = (struct hunkreloc *)reloclist->first;
-      while (next = (struct hunkreloc *)r->n.next) {
-        if (r->hunk_id==type && r->hunk_index==idx) {
-          if (shrt) {
-            fw16(f,r->hunk_offset,1);
-            bytes += 2;
-          }
-          else {
-            fw32(f,r->hunk_offset,1);
-            bytes += 4;
-          }
-          remnode(&r->n);
-          myfree(r);
-        }
-        r = next;
-      }
+    if (bytes == 0) {
+      if (shrt && type==HUNK_ABSRELOC32)
+        fw32(f,HUNK_DREL32,1);  /* RELOC32SHORT is DREL32 for OS2.0 */
+      else
+        fw32(f,type,1);
+      bytes = 4;
+    }
+    if (shrt) {
+      fw16(f,b->n,1);
+      fw16(f,b->idx,1);
+      for (i=0; i<b->n; i++)
+        fw16(f,b->r[i].hunk_offset,1);
+      bytes += 4 + 2*b->n;
     }
+    else {
+      fw32(f,b->n,1);
+      fw32(f,b->idx,1);
+      for (i=0; i<b->n; i++)
+        fw32(f,b->r[i].hunk_offset,1);
+      bytes += 8 + 4*b->n;
+    }
+    b->n = 0;  /* done */
   }
+  myfree(bl);
   if (bytes) {
     if (shrt) {
       fw16(f,0,1);
@@ -753,14 +820,15 @@ static void ext_defs(FILE *f,int symtype,int global,size_t idx,
 }
 
 
-static void report_bad_relocs(struct list *reloclist)
+static void report_bad_relocs(struct hunkreltab *reltab)
 {
-  struct hunkreloc *r;
+  uint32_t i,j;
 
-  /* report all remaining relocs in the list as unsupported */
-  for (r=(struct hunkreloc *)reloclist->first; r->n.next;
-       r=(struct hunkreloc *)r->n.next)
-    unsupp_reloc_error(r->rl);  /* reloc not supported */
+  /* report all remaining relocs in the table as unsupported */
+  for (i=0; i<reltab->n; i++) {
+    for (j=0; j<reltab->b[i].n; j++)
+      unsupp_reloc_error(reltab->b[i].r[j].rl);  /* reloc not supported */
+  }
 }
 
 
@@ -780,10 +848,11 @@ static void write_object(FILE *f,section *sec,symbol *sym)
       if (!(sec->flags & SEC_DELETED)) {
         uint32_t type;
         atom *a;
-        struct list reloclist,xreflist,linedblist;
+        struct hunkreltab reltab;
+        struct list xreflist,linedblist;
 
         wrotesec = 1;
-        initlist(&reloclist);
+        init_reloctab(&reltab);
         initlist(&xreflist);
         initlist(&linedblist);
 
@@ -804,27 +873,22 @@ static void write_object(FILE *f,section *sec,symbol *sym)
 
         if (type != HUNK_BSS) {
           /* write contents */
-          utaddr pc=0,npc,i;
+          utaddr pc=0,npc;
 
-          for (a=sec->first; a; a=a->next) {
-            rlist *rl;
+          fwsection(f,sec,0);
 
-            npc = fwpcalign(f,a,sec,pc);
+          for (a=sec->first; a; a=a->next) {
+            npc = pcalign(a,pc);
 
             if (genlinedebug && (a->type==DATA || a->type==SPACE))
               add_linedebug(&linedblist,a->src,a->line,npc);
 
-            if (a->type == DATA)
-              fwdata(f,a->content.db->data,a->content.db->size);
-            else if (a->type == SPACE)
-              fwsblock(f,a->content.sb);
-            else if (a->type == LINE && !genlinedebug)
+            if (a->type == LINE && !genlinedebug)
               add_linedebug(&linedblist,NULL,a->content.srcline,npc);
 
-            process_relocs(a,&reloclist,&xreflist,sec,npc);
-
             pc = npc + atom_size(a,sec,npc);
           }
+          process_relocs(sec,&reltab,&xreflist);
           if (type == HUNK_CODE && (pc&1) == 0)
             fwnopalign(f,pc);
           else
@@ -832,13 +896,14 @@ static void write_object(FILE *f,section *sec,symbol *sym)
         }
 
         /* relocation hunks */
-        reloc_hunk(f,HUNK_ABSRELOC32,0,&reloclist);
-        reloc_hunk(f,HUNK_RELRELOC8,0,&reloclist);
-        reloc_hunk(f,HUNK_RELRELOC16,0,&reloclist);
-        reloc_hunk(f,HUNK_RELRELOC26,0,&reloclist);
-        reloc_hunk(f,HUNK_RELRELOC32,0,&reloclist);
-        reloc_hunk(f,HUNK_DREL16,0,&reloclist);
-        report_bad_relocs(&reloclist);
+        reloc_hunk(f,HUNK_ABSRELOC32,0,&reltab);
+        reloc_hunk(f,HUNK_RELRELOC8,0,&reltab);
+        reloc_hunk(f,HUNK_RELRELOC16,0,&reltab);
+        reloc_hunk(f,HUNK_RELRELOC26,0,&reltab);
+        reloc_hunk(f,HUNK_RELRELOC32,0,&reltab);
+        reloc_hunk(f,HUNK_DREL16,0,&reltab);
+        report_bad_relocs(&reltab);
+        free_reloctab(&reltab);
 
         /* external references and global definitions */
         exthunk = 0;
@@ -898,9 +963,10 @@ static void write_exec(FILE *f,section *sec,symbol *sym)
       if (!(sec->flags & SEC_DELETED)) {
       	uint32_t type;
         atom *a;
-        struct list reloclist,linedblist;
+        struct hunkreltab reltab;
+        struct list linedblist;
 
-        initlist(&reloclist);
+        init_reloctab(&reltab);
         initlist(&linedblist);
 
         /* write hunk-type and size */
@@ -916,25 +982,21 @@ static void write_exec(FILE *f,section *sec,symbol *sym)
 
           size = databss ? file_size(sec) : sect_size(sec);
           fw32(f,(size+3)>>2,1);
+          if (size != 0)
+            fwsection(f,sec,size);
           for (a=sec->first,pc=0; a!=NULL&&pc<size; a=a->next) {
-            rlist *rl;
-
-            npc = fwpcalign(f,a,sec,pc);
+            npc = pcalign(a,pc);
 
             if (genlinedebug && (a->type==DATA || a->type==SPACE))
               add_linedebug(&linedblist,a->src,a->line,npc);
 
-            if (a->type == DATA)
-              fwdata(f,a->content.db->data,a->content.db->size);
-            else if (a->type == SPACE)
-              fwsblock(f,a->content.sb);
-            else if (a->type == LINE && !genlinedebug)
+            if (a->type == LINE && !genlinedebug)
               add_linedebug(&linedblist,NULL,a->content.srcline,npc);
 
-            process_relocs(a,&reloclist,NULL,sec,npc);
-
             pc = npc + atom_size(a,sec,npc);
           }
+          /* all atoms with relocations are within the file size */
+          process_relocs(sec,&reltab,NULL);
           if (type == HUNK_CODE && (pc&1) == 0 && a == NULL)
             fwnopalign(f,pc);
           else
@@ -944,11 +1006,12 @@ static void write_exec(FILE *f,section *sec,symbol *sym)
           fw32(f,(get_sec_size(sec)+3)>>2,1);
 
         if (!kick1)
-          reloc_hunk(f,HUNK_ABSRELOC32,1,&reloclist);
-        reloc_hunk(f,HUNK_ABSRELOC32,0,&reloclist);
+          reloc_hunk(f,HUNK_ABSRELOC32,1,&reltab);
+        reloc_hunk(f,HUNK_ABSRELOC32,0,&reltab);
         if (!kick1)  /* RELRELOC32 works with short 16-bit offsets only! */
-          reloc_hunk(f,HUNK_RELRELOC32,1,&reloclist);
-        report_bad_relocs(&reloclist);
+          reloc_hunk(f,HUNK_RELRELOC32,1,&reltab);
+        report_bad_relocs(&reltab);
+        free_reloctab(&reltab);
 
         if (!no_symbols) {
           /* symbol table */
@@ -3,13 +3,29 @@
 
 /* hunk-format relocs */
 struct hunkreloc {
-  struct node n;
   rlist *rl;
-  uint32_t hunk_id;
-  uint32_t hunk_index;
   uint32_t hunk_offset;
 };
 
+/* all relocs of one type into one target hunk */
+struct hunkrelbucket {
+  struct hunkreloc *r;
+  uint32_t n;
+  uint32_t max;
+  uint32_t maxoffs;
+  uint32_t type;
+  uint32_t idx;             /* target hunk */
+};
+
+/* the buckets of one hunk, created when used */
+struct hunkreltab {
+  struct hunkrelbucket *b;
+  uint32_t n;
+  uint32_t max;
+  uint32_t *hash;           /* bucket index+1 by type and target hunk */
+  uint32_t hsize;           /* power of two, more than twice n */
+};
+
 /* hunk-format external reference */
 struct hunkxref {
   struct node n;
@@ -0,0 +1,203 @@
+/* output_ihex.c Intel HEX output driver for vasm */
+/* based on the record buffering of the srec output module */
+
+#include "vasm.h"
+
+#ifdef OUTIHEX
+static char *copyright="vasm Intel HEX output module 1.0";
+
+#define I8HEX  0  /* 16-bit addresses only */
+#define I16HEX 1  /* extended segment address records, 20-bit addresses */
+#define I32HEX 2  /* extended linear address records, 32-bit addresses */
+static int ihexfmt = I32HEX;
+
+#define REC_DATA     0
+#define REC_EOF      1
+#define REC_EXTSEG   2
+#define REC_STARTSEG 3
+#define REC_EXTLIN   4
+#define REC_STARTLIN 5
+
+static size_t reclen = 32;
+static struct recbuf rb;
+static unsigned long long ext_addr;  /* current extended address base */
+
+static char *start_sym;
+static char default_start[] = "start";
+
+/* line buffer: colon, count, address, type, data, checksum, newline */
+static char line[1+2*(1+2+1+MAXRECDATA+1)+1];
+
+
+static void write_record(FILE *f,int type,unsigned addr,uint8_t *buf,size_t n)
+{
+  uint8_t checksum;
+  char *p = line;
+  size_t i;
+
+  *p++ = ':';
+  p = rec_hex(p,n);
+  p = rec_hex(p,(addr>>8)&0xff);
+  p = rec_hex(p,addr&0xff);
+  p = rec_hex(p,type);
+  checksum = n + (addr>>8) + addr + type;
+  for (i=0; i<n; i++) {
+    p = rec_hex(p,buf[i]);
+    checksum += buf[i];
+  }
+  p = rec_hex(p,-checksum);
+  *p++ = '\n';
+  fwdata(f,line,p-line);
+}
+
+
+static void write_ext_addr(FILE *f,unsigned long long addr)
+/* write an extended segment or linear address record, when the upper
+   address bits changed */
+{
+  unsigned long long base = addr & ~(unsigned long long)0xffff;
+  uint8_t buf[2];
+
+  if (base == ext_addr)
+    return;
+  ext_addr = base;
+  if (ihexfmt == I16HEX) {
+    setval(1,buf,2,base>>4);
+    write_record(f,REC_EXTSEG,0,buf,2);
+  }
+  else if (ihexfmt == I32HEX) {
+    setval(1,buf,2,base>>16);
+    write_record(f,REC_EXTLIN,0,buf,2);
+  }
+}
+
+
+static void write_data_record(FILE *f,struct recbuf *r)
+/* write the record buffer as data records, which must not cross
+   a 64K boundary */
+{
+  static const unsigned long long maxaddr[] = {
+    0xffff,0xfffff,0xffffffff
+  };
+  unsigned long long addr = r->addr;
+  uint8_t *p = r->data;
+  size_t n = r->size;
+  size_t chunk;
+
+  if (addr+n-1 > maxaddr[ihexfmt])
+    output_error(11,addr+n-1);  /* address out of range for format */
+
+  while (n) {
+    chunk = 0x10000 - (addr & 0xffff);
+    if (chunk > n)
+      chunk = n;
+    write_ext_addr(f,addr);
+    write_record(f,REC_DATA,addr&0xffff,p,chunk);
+    addr += chunk;
+    p += chunk;
+    n -= chunk;
+  }
+}
+
+
+static void write_start_record(FILE *f,unsigned long long addr)
+{
+  uint8_t buf[4];
+
+  if (ihexfmt == I16HEX) {
+    if (addr > 0xfffff)
+      output_error(11,addr);
+    setval(1,buf,2,(addr>>4)&0xf000);  /* CS */
+    setval(1,buf+2,2,addr&0xffff);     /* IP */
+    write_record(f,REC_STARTSEG,0,buf,4);
+  }
+  else if (ihexfmt == I32HEX) {
+    setval(1,buf,4,addr);
+    write_record(f,REC_STARTLIN,0,buf,4);
+  }
+}
+
+
+static void write_output(FILE *f,section *sec,symbol *sym)
+{
+  unsigned long long start_addr = 0;
+  int have_start = 0;
+
+  for (; sym; sym=sym->next) {
+    if (sym->type == IMPORT)
+      output_error(6,sym->name);  /* undefined symbol */
+    if (start_sym!=NULL && !strcmp(sym->name,start_sym)) {
+      start_addr = ULLTADDR(sym->pc);
+      have_start = 1;
+    }
+  }
+  if (start_sym!=NULL && !have_start)
+    output_error(6,start_sym);  /* undefined symbol */
+
+  if (reclen > MAXRECDATA) {
+    output_error(14,(int)reclen,MAXRECDATA);
+    reclen = MAXRECDATA;
+  }
+  rec_init(&rb,reclen,write_data_record);
+  ext_addr = 0;
+
+  /* every section is written as a contiguous block from its org,
+     gaps between sections are not filled */
+  for (; sec; sec=sec->next)
+    rec_section(f,&rb,sec);
+
+  if (have_start)
+    write_start_record(f,start_addr);
+  write_record(f,REC_EOF,0,NULL,0);
+}
+
+
+static int output_args(char *p)
+{
+  if (!strcmp(p,"-i8hex")) {
+    ihexfmt = I8HEX;
+    return 1;
+  }
+  else if (!strcmp(p,"-i16hex")) {
+    ihexfmt = I16HEX;
+    return 1;
+  }
+  else if (!strcmp(p,"-i32hex")) {
+    ihexfmt = I32HEX;
+    return 1;
+  }
+  else if (!strncmp(p,"-reclen=",8)) {
+    reclen = atoi(p+8);
+    if (reclen < 1)
+      reclen = 1;
+    return 1;
+  }
+  else if (!strcmp(p,"-exec")) {
+    start_sym = default_start;
+    return 1;
+  }
+  else if (!strncmp(p,"-exec=",6)) {
+    start_sym = p + 6;
+    return 1;
+  }
+  return 0;
+}
+
+
+int init_output_ihex(char **cp,void (**wo)(FILE *,section *,symbol *),
+                     int (**oa)(char *))
+{
+  *cp = copyright;
+  *wo = write_output;
+  *oa = output_args;
+  return 1;
+}
+
+#else
+
+int init_output_ihex(char **cp,void (**wo)(FILE *,section *,symbol *),
+                     int (**oa)(char *))
+{
+  return 0;
+}
+#endif
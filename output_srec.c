@@ -16,22 +16,11 @@ likely need to be converted to ASCII to use it elsewhere.
 #ifdef OUTSREC
 static char *copyright="vasm motorola srecord output module 1.0 (c) 2015 Joseph Zatarski";
 
-static uint8_t data[32];  /* acts as a buffer for data portion of a record */
-static size_t data_size;  /* indicates current size of data[] */
+static size_t reclen = 32;  /* data bytes per record */
+static struct recbuf rb;  /* buffers the data portion of a record */
 
-/*
- * holds address for the current record
- * should only be changed after writing the current record by calling
- * write_data_buffer (which will also change srec_pc automatically after writing
- * a record, based on the size of the record just written)
- */
-static unsigned long long srec_pc;
-
-/*
- * holds address which is updated for each byte written, rather than updated
- * after writing each record. This is needed for addralign() for example.
- */
-static unsigned long long pc;
+/* line buffer for a record: type, count, address, data, checksum, newline */
+static char line[2+2*(1+4+MAXRECDATA+1)+1];
 
 /* holds address for the start record
  * default of 0 is OK for not having a start address */
@@ -49,245 +38,79 @@ static char *start_sym; /* points to name of the start symbol, or NULL if not
 static char *default_start="start"; /* name of default execution address symbol
                                        for termination record */
 
-static void write_hex_byte(FILE *f, uint8_t byte)
-/* write a pair of ASCII characters to represent the byte in hex */
+static char *put_hex_byte(char *p, uint8_t byte, uint8_t *checksum)
+/* put a pair of ASCII characters representing the byte in hex into the
+ * line buffer and add the byte to the checksum */
 {
-  uint8_t temp;
-  
-  temp = ((byte & 0xf0) >> 4) + '0';  /* adds offset for character '0' */
-  if(temp > '9')  /* if the nibble isn't 0-9 */
-    temp += 'A' - '9' - 1; /* then we convert to A-F */
-  
-  fw8(f,temp);
-  
-  temp = (byte & 0x0f) + '0';  /* see above */
-  if(temp > '9')
-    temp += 'A' - '9' - 1;
-  
-  fw8(f,temp);
+  *checksum += byte;
+  return rec_hex(p, byte);
 }
 
-static void write_data_buffer(FILE *f, uint8_t type)
+static void write_record(FILE *f, int type, unsigned long long addr,
+                         int addrbytes, uint8_t *buf, size_t n)
 /*
- * writes the data buffer to the output file in a record
- * then updates srec_pc for next record
- * accepts type for number of srecord desired. Currently ignores unsupported
- * types, although that should never happen.
+ * formats a complete record in the line buffer and writes it with a
+ * single call
  */
 {
   uint8_t checksum = 0;
-  int i;
-  
-  char line_end[] = "\n";
-  
-  if(data_size == 0 && type != 0) /* allow S0 record to have data size of 0 */
-    return; /* nothing to write */
+  char *p = line;
+  size_t i;
 
-  /* check if address is out of range for this record type and error */
-  if(type > 0 && ((srec_pc >> ((type + 1) * 8)) != 0))
-    output_error(11,srec_pc);
-  
-  if(type <= 3)
-  {
-    fw8(f, 'S');
-    fw8(f, type + '0');
-  }
-  
-  else
-    return; /* ignore types we don't handle, but this shouldn't ever happen */
-  
-  if(type == 3)
-  {
-    write_hex_byte(f, data_size + 5); /* count: 4 bytes for address + checksum */
-    checksum += data_size + 5;
-  
-  }
+  *p++ = 'S';
+  *p++ = type + '0';
+  p = put_hex_byte(p, n + addrbytes + 1, &checksum); /* count incl. checksum */
 
-  else if(type == 2)
-  {
-    write_hex_byte(f, data_size + 4); /* count: 3 bytes for address + checksum */
-    checksum += data_size + 4;
-  }
-  
-  else if(type <= 1) /* type is uint, so no need to check if <0 */
-  {
-    write_hex_byte(f, data_size + 3); /* count: 2 bytes for address + checksum */
-    checksum += data_size + 3;
-  }
-  
-  if(type > 2)
-  {
-    write_hex_byte(f, (srec_pc & 0xff000000) >> 24);
-    checksum += (srec_pc & 0xff000000) >> 24;
-  }
-  
-  if(type > 1)
-  {
-    write_hex_byte(f, (srec_pc & 0xff0000) >> 16);
-    checksum += (srec_pc & 0xff0000) >> 16;
-  }
-  
-  if(type > 0)
-  {
-    write_hex_byte(f, (srec_pc & 0xff00) >> 8);
-    checksum += (srec_pc & 0xff00) >> 8;
-    write_hex_byte(f, srec_pc & 0xff);
-    checksum += srec_pc & 0xff;
-  }
-  
-  else /* type must be 0 */
-  {
-    write_hex_byte(f, 0);
-    write_hex_byte(f, 0);
-  }
-  
-  for(i=0; i < data_size; i++)
-  {
-    write_hex_byte(f, data[i]);
-    checksum += data[i];
-  }
-  
-  write_hex_byte(f, checksum ^ 0xff);
-  
-  for(i = 0; line_end[i] != '\0'; i++)
-    fw8(f, line_end[i]);
-  
-  srec_pc += data_size;
-  data_size = 0;
+  for(i = addrbytes; i > 0; i--)
+    p = put_hex_byte(p, (addr >> ((i - 1) * 8)) & 0xff, &checksum);
+
+  for(i = 0; i < n; i++)
+    p = put_hex_byte(p, buf[i], &checksum);
+
+  p = put_hex_byte(p, checksum ^ 0xff, &checksum);
+  *p++ = '\n';
+
+  fwdata(f, line, p - line);
 }
 
-static void write_termination_record(FILE *f)
-/* writes termination record, S7/8/9 depending on whether we're in S19/S28/S37
- * mode */
+static void write_data_record(FILE *f, struct recbuf *r)
+/*
+ * writes the record buffer to the output file in an S1/S2/S3 record,
+ * depending on S19/S28/S37 mode
+ */
 {
-  uint8_t checksum = 0;
-  
-  char line_end[] = "\n";
-  
-  int i;
-  
   /* check if address is out of range for this record type and error */
-  if(srecfmt > 0 && ((start_addr >> ((srecfmt + 1) * 8)) != 0))
-    output_error(11, start_addr);
-  
-  fw8(f, 'S');
-  fw8(f, (10 - srecfmt) + '0'); /* writes S header depending on S19/S28/S37 */
-  
-  if(srecfmt == S37)
-  {
-    write_hex_byte(f, 5); /* count: 4 bytes for address + checksum */
-    checksum += 5;
-  
-  }
+  if((r->addr >> ((srecfmt + 1) * 8)) != 0)
+    output_error(11, r->addr);
 
-  else if(srecfmt == S28)
-  {
-    write_hex_byte(f, 4); /* count: 3 bytes for address + checksum */
-    checksum += 4;
-  }
-  
-  else if(srecfmt == S19)
-  {
-    write_hex_byte(f, 3); /* count: 2 bytes for address + checksum */
-    checksum += 3;
-  }
-  
-  if(srecfmt >= S37)
-  {
-    write_hex_byte(f, (start_addr & 0xff000000) >> 24);
-    checksum += (start_addr & 0xff000000) >> 24;
-  }
-  
-  if(srecfmt >= S28)
-  {
-    write_hex_byte(f, (start_addr & 0xff0000) >> 16);
-    checksum += (start_addr & 0xff0000) >> 16;
-  }
-  
-  write_hex_byte(f, (start_addr & 0xff00) >> 8);
-  checksum += (start_addr & 0xff00) >> 8;
-  write_hex_byte(f, start_addr & 0xff);
-  checksum += start_addr & 0xff;
-  
-  write_hex_byte(f, checksum ^ 0xff);
-  
-  for(i = 0; line_end[i] != '\0'; i++)
-    fw8(f, line_end[i]);
+  write_record(f, srecfmt, r->addr, srecfmt + 1, r->data, r->size);
 }
 
-static void put_byte_in_buffer(FILE *f, uint8_t byte)
-/* puts a byte in the data buffer and flushes the buffer if we fill it up */
-/* also updates pc */
+static void write_header_record(FILE *f, char *name)
+/* writes an S0 record with a 16-bit address of 0 and the section name */
 {
-  data[data_size] = byte;
-  data_size++;
-  
-  if(data_size >= 32)
-    write_data_buffer(f, srecfmt);
-    
-  pc++;
+  size_t n;
+
+  for (n = 0; name[n] != '\0' && n < 32; n++)
+    ;
+  write_record(f, 0, 0, 2, (uint8_t *)name, n);
 }
 
-static void addralign(FILE *f,atom *a,section *sec)
-/* modified from fwpcalign() in supp.c */
+static void write_termination_record(FILE *f)
+/* writes termination record, S7/8/9 depending on whether we're in S19/S28/S37
+ * mode */
 {
-  int align_warning = 0;
-  taddr n = balign(pc,a->align);
-  taddr patlen;
-  uint8_t *pat;
-
-  if (n == 0)
-    return;
-
-  if (a->type==SPACE && a->content.sb->space==0) {  /* space align atom */
-    if (a->content.sb->maxalignbytes!=0 &&  n>a->content.sb->maxalignbytes)
-      return;
-    pat = a->content.sb->fill;
-    patlen = a->content.sb->size;
-  }
-  else {
-    pat = sec->pad;
-    patlen = sec->padbytes;
-  }
-
-  /*pc += n; */ /*done in put_byte_in_buffer()*/
-
-  while (n % patlen) {
-    if (!align_warning) {
-      align_warning = 1;
-      /*output_error(9,sec->name,(unsigned long)n,(unsigned long)patlen,
-                   ULLTADDR(pc));*/
-    }
-    put_byte_in_buffer(f,0);
-    n--;
-  }
-
-  /* write alignment pattern */
-  while (n >= patlen) {
-    int i;
-    for(i = 0; i < patlen; i++)
-    {
-      put_byte_in_buffer(f, *(pat + i));
-    }
-    n -= patlen;
-  }
-
-  while (n--) {
-    if (!align_warning) {
-      align_warning = 1;
-      /*output_error(9,sec->name,(unsigned long)n,(unsigned long)patlen,
-                   ULLTADDR(pc));*/
-    }
-    put_byte_in_buffer(f, 0);
-  }
+  /* check if address is out of range for this record type and error */
+  if(srecfmt > 0 && ((start_addr >> ((srecfmt + 1) * 8)) != 0))
+    output_error(11, start_addr);
+  
+  /* S7/S8/S9 with 4/3/2 address bytes, depending on S37/S28/S19 */
+  write_record(f, 10 - srecfmt, start_addr, srecfmt + 1, NULL, 0);
 }
 
 static void write_output(FILE *f,section *sec,symbol *sym)
 {
-  section *s,*s2,**seclist,**slp;
-  atom *p;
-  size_t nsecs;
-  unsigned long long i, j;
+  section *s;
 
   if (!sec)
     return;
@@ -306,37 +129,18 @@ static void write_output(FILE *f,section *sec,symbol *sym)
                              but we were unable to find it */
     output_error(6, start_sym);
 
+  /* count byte includes address and checksum */
+  if (reclen > 255 - (srecfmt + 2))
+  {
+    output_error(14, (int)reclen, 255 - (srecfmt + 2));
+    reclen = 255 - (srecfmt + 2);
+  }
+  rec_init(&rb, reclen, write_data_record);
+
   for (s=sec; s!=NULL; s=s->next)	/* iterate through sections */
   {
-    for (data_size = 0; (*(s->name + data_size) != '\0') && (data_size < 32); data_size++)
-    /* loop loads name of section into data and sets data_size properly */
-    {
-      data[data_size] = *(s->name + data_size);
-    }
-    write_data_buffer(f, 0); /* record type is S0 for header */
-    
-    pc = ULLTADDR(s->org);	/* start at the org address */
-    srec_pc = pc;		/* need to update both */
-    for (p=s->first; p; p=p->next)	/* iterate through atoms */
-    {
-      addralign(f,p,s);
-      if(p->type == DATA)
-        for (i = 0; i < p->content.db->size; i++)
-          put_byte_in_buffer(f,(uint8_t)p->content.db->data[i]);
-      else if (p->type == SPACE)
-      {
-        for (i = 0; i < p->content.sb->space; i++)
-        {
-          for (j = 0; j < p->content.sb->size; j++)
-          {
-            put_byte_in_buffer(f,p->content.sb->fill[j]);
-          }
-        }
-      } 
-    }
-    
-    write_data_buffer(f, srecfmt); /* now that we're done iterating through atoms */
-    /* flush buffer before moving on to next section */
+    write_header_record(f, s->name); /* record type is S0 for header */
+    rec_section(f, &rb, s); /* data records, starting at the org address */
   }
   
   /* after all sections finished, write terminating record */
@@ -362,6 +166,14 @@ static int output_args(char *p)
     return 1;
   }
   
+  else if (!strncmp(p, "-reclen=", 8))
+  {
+    reclen = atoi(p + 8);
+    if (reclen < 1)
+      reclen = 1;
+    return 1;
+  }
+  
   else if (!strcmp(p, "-exec"))
   {
     start_sym = default_start;
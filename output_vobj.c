@@ -98,29 +98,28 @@ static int sym_valid(symbol *symp)
   return 1;
 }
 
-static int count_relocs(rlist *rl)
+static taddr count_relocs(secreloc *rels,size_t n)
 {
-  int nrelocs;
+  taddr nrelocs=0;
+  size_t i;
 
-  for(nrelocs=0; rl; rl=rl->next) {
-    if(rl->type>=FIRST_STANDARD_RELOC && rl->type<=LAST_STANDARD_RELOC) {
-      nreloc *r = (nreloc *)rl->reloc;
-      if (r->sym->type==IMPORT&&!sym_valid(r->sym))
-        unsupp_reloc_error(rl);
+  for(i=0;i<n;i++){
+    if(rels[i].type>=FIRST_STANDARD_RELOC&&rels[i].type<=LAST_STANDARD_RELOC){
+      if(rels[i].sym->type==IMPORT&&!sym_valid(rels[i].sym))
+        unsupp_reloc_error(rels[i].rl);
       else
         nrelocs++;
     }
     else
-      unsupp_reloc_error(rl);
+      unsupp_reloc_error(rels[i].rl);
   }
   return nrelocs;
 }
 
-static void get_section_sizes(section *sec,taddr *rsize,taddr *rdata,taddr *rnrelocs)
+static void get_section_sizes(section *sec,taddr *rsize,taddr *rdata)
 {
-  taddr data=0,nrelocs=0;
+  taddr data=0;
   atom *p;
-  rlist *rl;
   int i;
 
   sec->pc=0;
@@ -129,11 +128,9 @@ static void get_section_sizes(section *sec,taddr *rsize,taddr *rdata,taddr *rnre
     sec->pc+=atom_size(p,sec,sec->pc);
     if(p->type==DATA){
       data=sec->pc;
-      nrelocs+=count_relocs(p->content.db->relocs);
     }
     else if(p->type==SPACE){
       if(p->content.sb->relocs){
-        nrelocs+=count_relocs(p->content.sb->relocs);
         data=sec->pc;
       }else{
         for(i=0;i<p->content.sb->size;i++)
@@ -144,62 +141,37 @@ static void get_section_sizes(section *sec,taddr *rsize,taddr *rdata,taddr *rnre
   }
   *rdata=data;
   *rsize=sec->pc;
-  *rnrelocs=nrelocs;
 }
 
 static void write_data(FILE *f,section *sec,taddr data)
 {
-  atom *p;
-  sec->pc=0;
-  for(p=sec->first;p;p=p->next){
-    if(sec->pc>=data)
-      return;
-    sec->pc=fwpcalign(f,p,sec,sec->pc);
-    sec->pc+=atom_size(p,sec,sec->pc);
-    if(p->type==DATA)
-      fwdata(f,p->content.db->data,p->content.db->size);
-    else if(p->type==SPACE)
-      fwsblock(f,p->content.sb);
-  }
+  if(data>0)
+    fwsection(f,sec,data);
 }
 
-static void write_rlist(FILE *f,section *sec,rlist *rl)
+static void write_relocs(FILE *f,secreloc *rels,size_t n)
 {
+  size_t i;
   int idx;
-  for(;rl;rl=rl->next){
-    if(rl->type>=FIRST_STANDARD_RELOC&&rl->type<=LAST_STANDARD_RELOC){
-      nreloc *rel=rl->reloc;
-      if(!(idx=rel->sym->idx)){
-        if(rel->sym->type==IMPORT&&!sym_valid(rel->sym))
+  for(i=0;i<n;i++){
+    secreloc *sr=&rels[i];
+    if(sr->type>=FIRST_STANDARD_RELOC&&sr->type<=LAST_STANDARD_RELOC){
+      if(!(idx=sr->sym->idx)){
+        if(sr->sym->type==IMPORT&&!sym_valid(sr->sym))
           continue;
-        idx=rel->sym->sec->idx;  /* symbol does not exist, use section-symbol */
+        idx=sr->sym->sec->idx;  /* symbol does not exist, use section-symbol */
       }
-      write_number(f,rl->type);
-      write_number(f,sec->pc+rel->byteoffset);
-      write_number(f,rel->bitoffset);
-      write_number(f,rel->size);
-      write_number(f,rel->mask);
-      write_number(f,rel->addend);
+      write_number(f,sr->type);
+      write_number(f,sr->offset);
+      write_number(f,sr->bitoffset);
+      write_number(f,sr->size);
+      write_number(f,sr->mask);
+      write_number(f,sr->addend);
       write_number(f,idx);
     }
   }
 }
 
-static void write_relocs(FILE *f,section *sec)
-{
-  atom *p;
-  rlist *rl;
-  sec->pc=0;
-  for(p=sec->first;p;p=p->next){
-    sec->pc=pcalign(p,sec->pc);
-    if(p->type==DATA)
-      write_rlist(f,sec,p->content.db->relocs);
-    else if(p->type==SPACE)
-      write_rlist(f,sec,p->content.sb->relocs);
-    sec->pc+=atom_size(p,sec,sec->pc);
-  }
-}
-
 static void write_output(FILE *f,section *sec,symbol *sym)
 {
   int nsyms,nsecs;
@@ -258,16 +230,22 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   }
 
   for(secp=sec;secp;secp=secp->next){
+    secreloc *rels;
+    size_t n;
+
     write_string(f,secp->name);
     write_string(f,secp->attr);
     write_number(f,secp->flags);
     write_number(f,secp->align);
-    get_section_sizes(secp,&size,&data,&nrelocs);
+    get_section_sizes(secp,&size,&data);
+    rels=collect_relocs(secp,&n);
+    nrelocs=count_relocs(rels,n);
     write_number(f,size);
     write_number(f,nrelocs);
     write_number(f,data);
     write_data(f,secp,data);
-    write_relocs(f,secp);
+    write_relocs(f,rels,n);
+    myfree(rels);
   }
 }
 
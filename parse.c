@@ -3,6 +3,7 @@
 
 #include "vasm.h"
 #include "osdep.h"
+#include "pch.h"
 
 int esc_sequences = 0;  /* do not handle escape sequences by default */
 int nocase_macros = 0;  /* macro names are case-insensitive */
@@ -905,17 +906,31 @@ static void start_repeat(char *rept_end)
 }
 
 
+/* link a complete macro definition into the list and hash-table */
+void link_macro(macro *m)
+{
+  hashdata data;
+
+  m->next = first_macro;
+  first_macro = m;
+  data.ptr = m;
+  add_hashentry(macrohash,m->name,data);
+}
+
+
+/* return the most recently defined macro, others are linked from there */
+macro *last_macro(void)
+{
+  return first_macro;
+}
+
+
 static void add_macro(void)
 {
   if (cur_macro!=NULL && cur_src!=NULL) {
     if (cur_macro->text != NULL) {
-      hashdata data;
-
       cur_macro->size = cur_src->srcptr - cur_macro->text;
-      cur_macro->next = first_macro;
-      first_macro = cur_macro;
-      data.ptr = cur_macro;
-      add_hashentry(macrohash,cur_macro->name,data);
+      link_macro(cur_macro);
     }
     cur_macro = NULL;
   }
@@ -1008,10 +1023,29 @@ section *find_structure(char *name,int name_len)
 }
 
 
+static char *list_text(char *txt,size_t len)
+/* keep a copy of an expanded source line for the listing */
+{
+  static char *pool;
+  static size_t poolfree;
+  char *p;
+
+  if (len > poolfree) {
+    pool = mymalloc(LISTPOOLSIZE);
+    poolfree = LISTPOOLSIZE;
+  }
+  p = pool;
+  memcpy(p,txt,len);
+  pool += len;
+  poolfree -= len;
+  return p;
+}
+
+
 /* reads the next input line */
 char *read_next_line(void)
 {
-  char *s,*srcend,*d;
+  char *s,*srcend,*d,*lstart;
   int nparam,len;
   char *rept_end = NULL;
 
@@ -1034,14 +1068,20 @@ char *read_next_line(void)
 #endif
       }
       else {
+        source *endsrc;
+
         if (cur_src->macro != NULL) {
           if (--cur_src->macro->recursions < 0)
             ierror(0);
         }
         myfree(cur_src->linebuf);  /* linebuf is no longer needed, saves memory */
         cur_src->linebuf = NULL;
-        if (cur_src->parent == NULL)
+        if (cur_src->parent == NULL) {
+          if (profiling)
+            profile_line(NULL);
           return NULL;  /* no parent source means end of assembly! */
+        }
+        endsrc = cur_src;
         cur_src = cur_src->parent;  /* return to parent source */
 #ifdef CARGSYM
         if (cur_src->cargexp) {
@@ -1052,12 +1092,19 @@ char *read_next_line(void)
 #ifdef REPTNSYM
         set_internal_abs(REPTNSYM,cur_src->reptn);  /* restore parent REPTN */
 #endif
+        if (endsrc->srcfile != NULL) {
+          pch_end(endsrc);  /* end of an include file */
+          if (tracing)
+            trace_end("\"lines\":%d",endsrc->line);
+        }
       }
     }
     else
       break;
   }
 
+  if (profiling)
+    profile_line(cur_src);
   cur_src->line++;
   s = cur_src->srcptr;
   d = cur_src->linebuf;
@@ -1136,6 +1183,7 @@ char *read_next_line(void)
     nparam = 0;  /* expand current repeat-iterator symbol into source */
 
   /* copy next line to linebuf */
+  lstart = s;
   while (s<srcend && *s!='\0') {
     int nc;
 
@@ -1201,8 +1249,17 @@ char *read_next_line(void)
     new->atom = 0;
     new->sec = 0;
     new->pc = 0;
+    new->cycles = new->xcycles = new->pgcross = 0;
     new->src = cur_src;
-    strncpy(new->txt,cur_src->linebuf+1,MAXLISTSRC);
+    new->txtlen = d - (cur_src->linebuf + 1);
+    if (new->txtlen > MAXLISTSRC)
+      new->txtlen = MAXLISTSRC;
+    /* a line without expansions is still available in the source text */
+    if (s-lstart >= new->txtlen &&
+        !memcmp(lstart,cur_src->linebuf+1,new->txtlen))
+      new->txt = lstart;
+    else
+      new->txt = list_text(cur_src->linebuf+1,new->txtlen);
     if (first_listing) {
       last_listing->next = new;
       last_listing = new;
@@ -64,6 +64,8 @@ int find_macarg_name(source *,char *,size_t);
 struct macarg *addmacarg(struct macarg **,char *,char *);
 macro *new_macro(char *,struct namelen *,char *);
 macro *find_macro(char *,int);
+void link_macro(macro *);
+macro *last_macro(void);
 int execute_macro(char *,int,char **,int *,int,char *);
 int leave_macro(void);
 int undef_macro(char *);
@@ -0,0 +1,868 @@
+/* pch.c - precompiled include files, selected by -pch-dir=<dir>
+
+   While an include file is parsed we record the symbols, macros and
+   register symbols it defines. When it did nothing else (no atoms, no
+   sections, no messages, no changes to older definitions, no directives
+   besides definitions, conditionals and includes) they are written
+   into <dir>/<key>.pch. The key covers the include's text, the options and
+   the names of all symbols and macros defined before. The values of older
+   symbols, which the include file referred to, are stored and compared.
+   A later inclusion with the same key and values loads the definitions
+   instead of parsing the file again. */
+
+#include "vasm.h"
+#include "osdep.h"
+#include "pch.h"
+
+#define PCH_ID "vasm precompiled include 1"
+#define PCH_HASH(h,v) h=cache_hash(h,&(v),sizeof(v))
+
+char *pch_dir;
+static uint64_t pch_env = CACHE_HASH_INIT;
+
+struct pchbuf {
+  uint8_t *data;
+  size_t len;   /* bytes written, or total size when reading */
+  size_t size;  /* allocated bytes */
+  size_t pos;   /* read position */
+  int bad;      /* tried to read beyond the end */
+};
+
+struct pchint {
+  symbol *sym;
+  expr *expr;  /* value of an internal symbol before the include */
+};
+
+struct pchfile {
+  struct pchfile *next;
+  struct source_file *srcfile;
+  source *src;
+  int parent,line;
+};
+
+#ifdef HAVE_REGSYMS
+struct pchreg {
+  struct pchreg *next;
+  char *name;
+  int undef,no_case,type;
+  unsigned int flags,num;
+};
+#endif
+
+static struct {
+  source *src;       /* include file being recorded, NULL otherwise */
+  uint64_t key;
+  uint64_t state;    /* pch_snapshot() before the include */
+  symbol *symbols;
+  macro *macros;
+  section *cursec;
+  symbol **used;         /* older symbols which were already USED */
+  int nused;
+  struct pchint *ints;   /* internal symbols, which may change on every line */
+  int nints;
+  int errors,warnings,failed;
+  unsigned long srcid;
+  struct pchfile *files,*lastfile;
+  int nfiles;
+#ifdef HAVE_REGSYMS
+  struct pchreg *regs,*lastreg;
+  int nregs;
+#endif
+} pch;
+
+#define PCH_FLAGMASK (~(uint32_t)(INEVAL|REFERENCED|USED))
+
+static void pch_put(struct pchbuf *b,const void *p,size_t n)
+{
+  if (b->len+n > b->size) {
+    b->size = b->len + n + 0x1000;
+    b->data = myrealloc(b->data,b->size);
+  }
+  memcpy(b->data+b->len,p,n);
+  b->len += n;
+}
+
+static void pch_putnum(struct pchbuf *b,int64_t v)
+{
+  pch_put(b,&v,sizeof(v));
+}
+
+static void pch_putstr(struct pchbuf *b,const char *s,size_t n)
+{
+  pch_putnum(b,n);
+  pch_put(b,s,n);
+  pch_put(b,"",1);
+}
+
+static void pch_putexpr(struct pchbuf *b,expr *e)
+{
+  if (e == NULL) {
+    pch_putnum(b,-1);
+    return;
+  }
+  pch_putnum(b,e->type);
+  switch (e->type) {
+    case NUM:
+      pch_putnum(b,e->c.val);
+      break;
+    case HUG:
+      pch_put(b,&e->c.huge,sizeof(thuge));
+      break;
+    case FLT:
+      pch_put(b,&e->c.flt,sizeof(tfloat));
+      break;
+    case SYM:
+      pch_putstr(b,e->c.sym->name,strlen(e->c.sym->name));
+      break;
+    default:
+      pch_putexpr(b,e->left);
+      pch_putexpr(b,e->right);
+      break;
+  }
+}
+
+static void pch_putargs(struct pchbuf *b,struct macarg *ma)
+{
+  struct macarg *a;
+  int n;
+
+  for (n=0,a=ma; a; a=a->argnext)
+    n++;
+  pch_putnum(b,n);
+  for (a=ma; a; a=a->argnext) {
+    pch_putnum(b,a->arglen);
+    if (a->arglen != MACARG_REQUIRED)
+      pch_putstr(b,a->argname,a->arglen);
+  }
+}
+
+static void pch_get(struct pchbuf *b,void *p,size_t n)
+{
+  if (b->bad || n>b->len-b->pos) {
+    b->bad = 1;
+    memset(p,0,n);
+  }
+  else {
+    memcpy(p,b->data+b->pos,n);
+    b->pos += n;
+  }
+}
+
+static int64_t pch_getnum(struct pchbuf *b)
+{
+  int64_t v;
+
+  pch_get(b,&v,sizeof(v));
+  return v;
+}
+
+static char *pch_getstr(struct pchbuf *b,size_t *len)
+/* returns a pointer into the buffer, the string is 0-terminated */
+{
+  uint64_t n = pch_getnum(b);
+  char *s;
+
+  if (b->bad || n>=b->len-b->pos) {
+    b->bad = 1;
+    s = emptystr;
+    n = 0;
+  }
+  else {
+    s = (char *)b->data + b->pos;
+    b->pos += n + 1;
+  }
+  if (len)
+    *len = n;
+  return s;
+}
+
+static expr *pch_getexpr(struct pchbuf *b)
+{
+  int type = (int)pch_getnum(b);
+  expr *e;
+
+  if (type<0 || b->bad)
+    return NULL;
+  e = new_expr();
+  e->type = type;
+  switch (type) {
+    case NUM:
+      e->c.val = (taddr)pch_getnum(b);
+      break;
+    case HUG:
+      pch_get(b,&e->c.huge,sizeof(thuge));
+      break;
+    case FLT:
+      pch_get(b,&e->c.flt,sizeof(tfloat));
+      break;
+    case SYM: {
+      char *name = pch_getstr(b,NULL);
+
+      if (!(e->c.sym = find_symbol(name)))
+        e->c.sym = new_import(name);
+      e->c.sym->flags |= USED;
+      break;
+    }
+    default:
+      e->left = pch_getexpr(b);
+      e->right = pch_getexpr(b);
+      break;
+  }
+  return e;
+}
+
+static void pch_getargs(struct pchbuf *b,struct macarg **list)
+{
+  int n = (int)pch_getnum(b);
+  size_t len;
+  char *s;
+
+  while (n-- > 0 && !b->bad) {
+    if (pch_getnum(b) == MACARG_REQUIRED)
+      addmacarg(list,NULL,NULL);
+    else {
+      s = pch_getstr(b,&len);
+      addmacarg(list,s,s+len);
+    }
+  }
+}
+
+static char *pch_name(uint64_t key)
+{
+  char *name = mymalloc(strlen(pch_dir) + 22);
+
+  sprintf(name,"%s/%016llx.pch",pch_dir,(unsigned long long)key);
+  return name;
+}
+
+static void pch_putvalue(struct pchbuf *b,symbol *sym,expr *e)
+/* value of an older symbol, which the include file depends on */
+{
+  pch_putnum(b,sym->type);
+  if (sym->type == LABSYM) {
+    pch_putstr(b,sym->sec->name,strlen(sym->sec->name));
+    pch_putnum(b,sym->pc);
+  }
+  else if (sym->type == EXPRESSION)
+    pch_putexpr(b,e);
+}
+
+static expr *pch_intexpr(symbol *sym)
+/* returns the value of a symbol before the include */
+{
+  int i;
+
+  for (i=0; i<pch.nints; i++) {
+    if (pch.ints[i].sym == sym)
+      return pch.ints[i].expr;
+  }
+  return sym->expr;
+}
+
+static uint64_t pch_key(struct source_file *srcfile)
+/* hash of the include file and of the names which were defined before */
+{
+  struct pchbuf b;
+  struct include_path *ipath;
+  struct source_file *sf;
+  symbol *sym;
+  macro *m;
+  char *lgl;
+  uint64_t h;
+
+  memset(&b,0,sizeof(b));
+  pch_putstr(&b,srcfile->name,strlen(srcfile->name));
+  for (ipath=first_incpath; ipath; ipath=ipath->next)
+    pch_putstr(&b,ipath->path,strlen(ipath->path));
+  if (ignore_multinc) {
+    /* files which were loaded before would be skipped */
+    for (sf=first_source; sf; sf=sf->next)
+      pch_putstr(&b,sf->name,strlen(sf->name));
+  }
+  lgl = set_last_global_label(NULL);
+  set_last_global_label(lgl);
+  pch_putstr(&b,lgl,strlen(lgl));
+
+  for (sym=first_symbol; sym; sym=sym->next) {
+    pch_putstr(&b,sym->name,strlen(sym->name));
+    pch_putnum(&b,sym->type);
+    pch_putnum(&b,sym->flags&PCH_FLAGMASK);
+  }
+  for (m=last_macro(); m; m=m->next)
+    pch_putstr(&b,m->name,strlen(m->name));
+
+  h = cache_hash(pch_env,srcfile->text,srcfile->size);
+  h = cache_hash(h,b.data,b.len);
+  myfree(b.data);
+  return h;
+}
+
+static uint64_t pch_snapshot(symbol *symbols,macro *macros)
+/* checksum of older definitions and sections, to detect modifications */
+{
+  uint64_t h = CACHE_HASH_INIT;
+  symbol *sym;
+  macro *m;
+  section *sec;
+  uint32_t flags;
+  int found;
+
+  for (sym=symbols; sym; sym=sym->next) {
+    flags = sym->flags & PCH_FLAGMASK;
+    PCH_HASH(h,sym);
+    PCH_HASH(h,sym->type);
+    PCH_HASH(h,flags);
+    if (!(sym->flags & VASMINTERN))
+      PCH_HASH(h,sym->expr);
+    PCH_HASH(h,sym->size);
+    PCH_HASH(h,sym->sec);
+    PCH_HASH(h,sym->pc);
+  }
+  for (m=macros; m; m=m->next) {
+    found = find_macro(m->name,strlen(m->name)) == m;
+    PCH_HASH(h,m);
+    PCH_HASH(h,found);
+  }
+  for (sec=first_section; sec; sec=sec->next) {
+    PCH_HASH(h,sec);
+    PCH_HASH(h,sec->last);
+    PCH_HASH(h,sec->flags);
+    PCH_HASH(h,sec->pc);
+    PCH_HASH(h,sec->org);
+  }
+  PCH_HASH(h,current_section);
+  return h;
+}
+
+void pch_options(int argc,char **argv,char *copyright)
+/* all options which may change the parser's results select the entries */
+{
+  size_t n = sizeof(taddr);
+  int i;
+
+  for (i=1; i<argc; i++) {
+    if (argv[i][0] != '-')
+      continue;  /* source name or option which was already handled */
+    if ((!strcmp("-o",argv[i]) || !strcmp("-L",argv[i])) && i<argc-1) {
+      i++;
+      continue;
+    }
+    if (!strncmp("-L",argv[i],2) || !strncmp("-depend",argv[i],7))
+      continue;
+    pch_env = cache_hash(pch_env,argv[i],strlen(argv[i])+1);
+  }
+  pch_env = cache_hash(pch_env,PCH_ID,strlen(PCH_ID));
+  pch_env = cache_hash(pch_env,copyright,strlen(copyright));
+  pch_env = cache_hash(pch_env,cpu_copyright,strlen(cpu_copyright));
+  pch_env = cache_hash(pch_env,syntax_copyright,strlen(syntax_copyright));
+  pch_env = cache_hash(pch_env,output_format,strlen(output_format));
+  PCH_HASH(pch_env,n);
+}
+
+static int pch_file(source *src)
+/* index of a recorded source file instance */
+{
+  struct pchfile *pf;
+  int i;
+
+  for (pf=pch.files,i=0; pf; pf=pf->next,i++) {
+    if (pf->src == src)
+      return i;
+  }
+  return -1;
+}
+
+void pch_source(source *src)
+/* a new include file instance was created from include_source() */
+{
+  struct pchfile *pf;
+  symbol *sym;
+  source *p;
+  int n;
+
+  if (pch.src == NULL) {
+    if (src->parent == NULL)
+      return;  /* main source */
+    pch.src = src;
+    pch.symbols = first_symbol;
+    pch.macros = last_macro();
+    pch.cursec = current_section;
+    pch.state = pch_snapshot(pch.symbols,pch.macros);
+    pch.errors = errors;
+    pch.warnings = warnings;
+    pch.failed = 0;
+    pch.srcid = src->id;
+
+    /* clear USED flags, to find out which older symbols are referenced */
+    for (n=0,sym=first_symbol; sym; sym=sym->next)
+      n++;
+    pch.used = mymalloc((n+1)*sizeof(symbol *));
+    pch.ints = mymalloc((n+1)*sizeof(struct pchint));
+    pch.nused = pch.nints = 0;
+    for (sym=first_symbol; sym; sym=sym->next) {
+      if (sym->flags & USED) {
+        pch.used[pch.nused++] = sym;
+        sym->flags &= ~USED;
+      }
+      if ((sym->flags&VASMINTERN) && sym->type==EXPRESSION) {
+        pch.ints[pch.nints].sym = sym;
+        pch.ints[pch.nints++].expr = sym->expr;
+      }
+    }
+  }
+
+  pf = mymalloc(sizeof(struct pchfile));
+  pf->next = NULL;
+  pf->srcfile = src->srcfile;
+  pf->src = src;
+  pf->parent = -1;
+  pf->line = 0;
+  if (pch.files) {
+    /* nested include: find the including file */
+    for (p=src->parent; p!=NULL && p->srcfile==NULL; p=p->parent);
+    if (p==NULL || (pf->parent = pch_file(p)) < 0)
+      pch.failed = 1;
+    else
+      pf->line = p->line;
+    pch.lastfile = pch.lastfile->next = pf;
+  }
+  else
+    pch.files = pch.lastfile = pf;
+  pch.nfiles++;
+}
+
+#ifdef HAVE_REGSYMS
+void pch_regsym(int undef,int no_case,char *name,int type,
+                unsigned int flags,unsigned int num)
+{
+  struct pchreg *r;
+
+  if (pch.src == NULL)
+    return;
+  r = mymalloc(sizeof(struct pchreg));
+  r->next = NULL;
+  r->name = mystrdup(name);
+  r->undef = undef;
+  r->no_case = no_case;
+  r->type = type;
+  r->flags = flags;
+  r->num = num;
+  if (pch.regs)
+    pch.lastreg = pch.lastreg->next = r;
+  else
+    pch.regs = pch.lastreg = r;
+  pch.nregs++;
+}
+#endif
+
+static void pch_write(symbol **syms,int nsyms,macro **macs,int nmacs)
+{
+  struct pchbuf b;
+  struct pchfile *pf;
+#ifdef HAVE_REGSYMS
+  struct pchreg *r;
+#endif
+  struct pchbuf v;
+  symbol *sym;
+  char *name,*tmp;
+  uint64_t h;
+  FILE *f;
+  int i,n;
+
+  memset(&b,0,sizeof(b));
+  pch_putstr(&b,PCH_ID,strlen(PCH_ID));
+  pch_putnum(&b,pch.nfiles);
+  for (pf=pch.files; pf; pf=pf->next) {
+    pch_putstr(&b,pf->srcfile->name,strlen(pf->srcfile->name));
+    pch_putnum(&b,cache_hash(CACHE_HASH_INIT,pf->srcfile->text,
+                             pf->srcfile->size));
+    pch_putnum(&b,pf->parent);
+    pch_putnum(&b,pf->line);
+  }
+  pch_putnum(&b,source_id-pch.srcid);
+
+  /* older symbols which were referenced, their values must not change */
+  for (n=0,sym=pch.symbols; sym; sym=sym->next) {
+    if (sym->flags & USED)
+      n++;
+  }
+  pch_putnum(&b,n);
+  for (sym=pch.symbols; sym; sym=sym->next) {
+    if (sym->flags & USED) {
+      memset(&v,0,sizeof(v));
+      pch_putvalue(&v,sym,pch_intexpr(sym));
+      pch_putstr(&b,sym->name,strlen(sym->name));
+      pch_putstr(&b,(char *)v.data,v.len);
+      myfree(v.data);
+    }
+  }
+
+  /* create all symbols first, then their expressions may refer to them */
+  pch_putnum(&b,nsyms);
+  for (i=0; i<nsyms; i++) {
+    pch_putstr(&b,syms[i]->name,strlen(syms[i]->name));
+    pch_putnum(&b,syms[i]->type);
+    pch_putnum(&b,syms[i]->flags&~INEVAL);
+    pch_putnum(&b,syms[i]->align);
+  }
+  for (i=0; i<nsyms; i++) {
+    pch_putexpr(&b,syms[i]->type==EXPRESSION?syms[i]->expr:NULL);
+    pch_putexpr(&b,syms[i]->size);
+  }
+
+  /* new values of internal symbols */
+  for (n=0,i=0; i<pch.nints; i++) {
+    if (pch.ints[i].sym->expr != pch.ints[i].expr)
+      n++;
+  }
+  pch_putnum(&b,n);
+  for (i=0; i<pch.nints; i++) {
+    if ((sym = pch.ints[i].sym)->expr != pch.ints[i].expr) {
+      pch_putstr(&b,sym->name,strlen(sym->name));
+      pch_putexpr(&b,sym->expr);
+    }
+  }
+
+#ifdef HAVE_REGSYMS
+  pch_putnum(&b,pch.nregs);
+  for (r=pch.regs; r; r=r->next) {
+    pch_putstr(&b,r->name,strlen(r->name));
+    pch_putnum(&b,r->undef);
+    pch_putnum(&b,r->no_case);
+    pch_putnum(&b,r->type);
+    pch_putnum(&b,r->flags);
+    pch_putnum(&b,r->num);
+  }
+#else
+  pch_putnum(&b,0);
+#endif
+
+  pch_putnum(&b,nmacs);
+  for (i=0; i<nmacs; i++) {
+    pch_putstr(&b,macs[i]->name,strlen(macs[i]->name));
+    pch_putstr(&b,macs[i]->text,macs[i]->size);
+    pch_putnum(&b,pch_file(macs[i]->defsrc));
+    pch_putnum(&b,macs[i]->defline);
+    pch_putnum(&b,macs[i]->num_argnames);
+    pch_putnum(&b,macs[i]->vararg);
+    pch_putargs(&b,macs[i]->argnames);
+    pch_putargs(&b,macs[i]->defaults);
+  }
+  h = cache_hash(CACHE_HASH_INIT,b.data,b.len);
+  pch_putnum(&b,h);
+
+  /* write a temporary file first, so a .pch file is always complete */
+  name = pch_name(pch.key);
+  tmp = mymalloc(strlen(name) + 5);
+  sprintf(tmp,"%s.tmp",name);
+  if (f = fopen(tmp,"wb")) {
+    i = fwrite(b.data,1,b.len,f) == b.len;
+    if (fclose(f)==0 && i) {
+      remove(name);
+      rename(tmp,name);
+    }
+    else
+      remove(tmp);
+  }
+  myfree(tmp);
+  myfree(name);
+  myfree(b.data);
+}
+
+void pch_end(source *src)
+/* called when an include file was completely parsed */
+{
+  struct pchfile *pf;
+  symbol **syms=NULL,*sym;
+  macro **macs=NULL,*m;
+  int i,nsyms,nmacs;
+
+  if (src!=pch.src || src==NULL)
+    return;
+
+  if (!pch.failed && errors==pch.errors && warnings==pch.warnings &&
+      current_section==pch.cursec &&
+      pch_snapshot(pch.symbols,pch.macros)==pch.state) {
+    /* collect the new symbols and macros in order of definition */
+    for (nsyms=0,sym=first_symbol; sym && sym!=pch.symbols; sym=sym->next) {
+      if (sym->type == LABSYM)
+        break;
+      nsyms++;
+    }
+    for (nmacs=0,m=last_macro(); m && m!=pch.macros; m=m->next) {
+      if (pch_file(m->defsrc) < 0)
+        break;
+      nmacs++;
+    }
+    if (sym==pch.symbols && m==pch.macros) {
+      syms = mymalloc((nsyms+1)*sizeof(symbol *));
+      for (i=nsyms,sym=first_symbol; i>0; sym=sym->next)
+        syms[--i] = sym;
+      macs = mymalloc((nmacs+1)*sizeof(macro *));
+      for (i=nmacs,m=last_macro(); i>0; m=m->next)
+        macs[--i] = m;
+      pch_write(syms,nsyms,macs,nmacs);
+      myfree(syms);
+      myfree(macs);
+    }
+  }
+
+  for (i=0; i<pch.nused; i++)
+    pch.used[i]->flags |= USED;
+  myfree(pch.used);
+  myfree(pch.ints);
+  while (pf = pch.files) {
+    pch.files = pf->next;
+    myfree(pf);
+  }
+#ifdef HAVE_REGSYMS
+  while (pch.regs) {
+    struct pchreg *r = pch.regs;
+    pch.regs = r->next;
+    myfree(r->name);
+    myfree(r);
+  }
+  pch.nregs = 0;
+#endif
+  pch.nfiles = 0;
+  pch.src = NULL;
+}
+
+void pch_cancel(void)
+/* called by the syntax module for a directive, which has other effects
+   than defining symbols, macros or registers */
+{
+  pch.failed = 1;
+}
+
+int pch_include(struct source_file *srcfile)
+/* try to load the definitions of an include file from a precompiled file,
+   returns 0 when it has to be parsed */
+{
+  struct pchbuf b;
+  struct source_file **files;
+  source **srcs;
+  char **paths,*name;
+  uint64_t h;
+  FILE *f;
+  int i,j,nfiles,ok;
+
+  if (pch.src!=NULL || cur_src==NULL)
+    return 0;  /* recording, or main source */
+  pch.key = pch_key(srcfile);
+
+  /* read the whole file and verify its checksum */
+  memset(&b,0,sizeof(b));
+  name = pch_name(pch.key);
+  f = fopen(name,"rb");
+  myfree(name);
+  if (f == NULL)
+    return 0;
+  for (;;) {
+    if (b.len == b.size) {
+      b.size += 0x10000;
+      b.data = myrealloc(b.data,b.size);
+    }
+    if ((i = fread(b.data+b.len,1,b.size-b.len,f)) <= 0)
+      break;
+    b.len += i;
+  }
+  fclose(f);
+  ok = b.len > sizeof(h);
+  if (ok) {
+    b.len -= sizeof(h);
+    memcpy(&h,b.data+b.len,sizeof(h));
+    ok = h==cache_hash(CACHE_HASH_INIT,b.data,b.len) &&
+         !strcmp(pch_getstr(&b,NULL),PCH_ID);
+  }
+  nfiles = ok ? (int)pch_getnum(&b) : 0;
+  if (nfiles<=0 || nfiles>b.len) {
+    myfree(b.data);
+    return 0;
+  }
+
+  /* check that all nested include files are unchanged */
+  files = mymalloc(nfiles*sizeof(struct source_file *));
+  paths = mymalloc(nfiles*sizeof(char *));
+  srcs = mymalloc(nfiles*sizeof(source *));
+  for (i=0; i<nfiles; i++) {
+    struct source_file *sf;
+    char pathbuf[MAXPATHLEN];
+    struct include_path *ipath;
+
+    name = pch_getstr(&b,NULL);
+    h = pch_getnum(&b);
+    pch_getnum(&b);  /* parent */
+    pch_getnum(&b);  /* line */
+    paths[i] = NULL;
+    if (i == 0)
+      sf = !filenamecmp(name,srcfile->name) ? srcfile : NULL;
+    else if (!(sf = find_source_file(name))) {
+      for (j=0; j<i; j++) {
+        if (!filenamecmp(name,files[j]->name))
+          break;
+      }
+      if (j < i)
+        sf = files[j];
+      else if (f = search_file(name,"r",&ipath,pathbuf)) {
+        if (sf = read_source_file(f,mystrdup(name),ipath))
+          paths[i] = mystrdup(pathbuf);
+        fclose(f);
+      }
+    }
+    files[i] = sf;
+    if (sf==NULL || b.bad ||
+        h!=cache_hash(CACHE_HASH_INIT,sf->text,sf->size)) {
+      ok = 0;
+      nfiles = i + 1;
+      break;
+    }
+  }
+
+  if (ok) {
+    /* check the values of older symbols, which were referenced */
+    struct pchbuf v;
+    symbol *sym;
+    size_t len;
+    char *val;
+    int n;
+
+    pch_getnum(&b);  /* source ids */
+    for (n=(int)pch_getnum(&b); n>0 && ok; n--) {
+      name = pch_getstr(&b,NULL);
+      val = pch_getstr(&b,&len);
+      if ((sym = find_symbol(name)) && !b.bad) {
+        memset(&v,0,sizeof(v));
+        pch_putvalue(&v,sym,sym->expr);
+        ok = v.len==len && !memcmp(v.data,val,len);
+        myfree(v.data);
+      }
+      else
+        ok = 0;
+    }
+  }
+
+  if (ok) {
+    symbol **syms,*sym;
+    macro *m;
+    int n;
+
+    /* register the new source files like parsing them would have done */
+    b.pos = 0;
+    pch_getstr(&b,NULL);
+    pch_getnum(&b);
+    for (i=0; i<nfiles; i++) {
+      pch_getstr(&b,NULL);
+      pch_getnum(&b);
+      j = (int)pch_getnum(&b);
+      if (paths[i]) {
+        use_file(paths[i]);
+        add_source_file(files[i]);
+      }
+      /* macros refer to their defining source for messages */
+      srcs[i] = new_source(files[i]->name,files[i],files[i]->text,
+                           files[i]->size);
+      myfree(srcs[i]->linebuf);
+      srcs[i]->linebuf = NULL;
+      if (j>=0 && j<i) {
+        srcs[i]->parent = srcs[j];
+        srcs[i]->parent_line = (int)pch_getnum(&b);
+      }
+      else
+        pch_getnum(&b);
+    }
+    source_id = srcs[0]->id + (unsigned long)pch_getnum(&b);
+
+    for (n=(int)pch_getnum(&b); n>0; n--) {
+      if (sym = find_symbol(pch_getstr(&b,NULL)))
+        sym->flags |= USED;
+      pch_getstr(&b,NULL);
+    }
+
+    n = (int)pch_getnum(&b);
+    syms = mymalloc((n+1)*sizeof(symbol *));
+    for (i=0; i<n; i++) {
+      syms[i] = mymalloc(sizeof(symbol));
+      syms[i]->name = mystrdup(pch_getstr(&b,NULL));
+      syms[i]->type = (int)pch_getnum(&b);
+      syms[i]->flags = (uint32_t)pch_getnum(&b);
+      syms[i]->align = (taddr)pch_getnum(&b);
+      syms[i]->expr = syms[i]->size = NULL;
+      syms[i]->sec = NULL;
+      syms[i]->pc = 0;
+      add_symbol(syms[i]);
+    }
+    for (i=0; i<n; i++) {
+      syms[i]->expr = pch_getexpr(&b);
+      syms[i]->size = pch_getexpr(&b);
+    }
+    myfree(syms);
+
+    for (n=(int)pch_getnum(&b); n>0; n--) {
+      if (sym = find_symbol(pch_getstr(&b,NULL)))
+        sym->expr = pch_getexpr(&b);
+      else
+        b.bad = 1;
+    }
+
+    for (n=(int)pch_getnum(&b); n>0; n--) {
+      name = pch_getstr(&b,NULL);
+#ifdef HAVE_REGSYMS
+      {
+        int undef = (int)pch_getnum(&b);
+        int no_case = (int)pch_getnum(&b);
+        int type = (int)pch_getnum(&b);
+        unsigned int flags = (unsigned int)pch_getnum(&b);
+        unsigned int num = (unsigned int)pch_getnum(&b);
+
+        if (undef)
+          undef_regsym(name,no_case,type);
+        else
+          new_regsym(1,no_case,name,type,flags,num);
+      }
+#endif
+    }
+
+    for (n=(int)pch_getnum(&b); n>0 && !b.bad; n--) {
+      size_t len;
+      char *text;
+
+      m = mymalloc(sizeof(macro));
+      m->name = mystrdup(pch_getstr(&b,NULL));
+      text = pch_getstr(&b,&len);
+      m->text = mymalloc(len+1);
+      memcpy(m->text,text,len+1);
+      m->size = len;
+      i = (int)pch_getnum(&b);
+      m->defsrc = i>=0 && i<nfiles ? srcs[i] : srcs[0];
+      m->defline = (int)pch_getnum(&b);
+      m->num_argnames = (int)pch_getnum(&b);
+      m->vararg = (int)pch_getnum(&b);
+      m->argnames = m->defaults = NULL;
+      pch_getargs(&b,&m->argnames);
+      pch_getargs(&b,&m->defaults);
+      m->recursions = 0;
+      link_macro(m);
+    }
+    if (b.bad)
+      ierror(0);
+  }
+  else {
+    /* source files, which were only loaded for checking, are not needed */
+    for (i=0; i<nfiles; i++) {
+      if (paths[i]) {
+        if (files[i]->size > 1)
+          myfree(files[i]->text);
+        myfree(files[i]->name);
+        myfree(files[i]);
+      }
+    }
+  }
+  for (i=0; i<nfiles; i++)
+    myfree(paths[i]);
+  myfree(paths);
+  myfree(files);
+  myfree(srcs);
+  myfree(b.data);
+  return ok;
+}
@@ -0,0 +1,19 @@
+/* pch.h - precompiled include files */
+
+#ifndef PCH_H
+#define PCH_H
+
+/* global variables */
+extern char *pch_dir;
+
+/* functions */
+void pch_options(int,char **,char *);
+int pch_include(struct source_file *);
+void pch_source(source *);
+void pch_end(source *);
+void pch_cancel(void);
+#ifdef HAVE_REGSYMS
+void pch_regsym(int,int,char *,int,unsigned int,unsigned int);
+#endif
+
+#endif /* PCH_H */
@@ -0,0 +1,191 @@
+/* profile.c - attribution of assembly costs to include files and macros */
+
+#include "vasm.h"
+
+#define PROFHTABSIZE 0x1000
+
+int profiling;
+
+static hashtable *filetab,*macrotab,*stacktab;
+static struct profile *first_profile;
+static struct profstack *first_stack,*last_stack;
+static struct profile *cur_prof;
+static clock_t last_clock;
+
+
+static struct profile *find_profile(hashtable **tab,char *name,int is_macro,
+                                    source *defsrc,int defline)
+{
+  struct profile *new;
+  hashdata data;
+
+  if (*tab == NULL)
+    *tab = new_hashtable(PROFHTABSIZE);
+  else if (find_name(*tab,name,&data))
+    return data.ptr;
+
+  new = mycalloc(sizeof(struct profile));
+  new->name = name;
+  new->is_macro = is_macro;
+  new->defsrc = defsrc;
+  new->defline = defline;
+  new->next = first_profile;
+  first_profile = new;
+  data.ptr = new;
+  add_hashentry(*tab,name,data);
+  return new;
+}
+
+
+/* returns the expansion path of a source, repetitions belong to the
+   include file or macro they are in */
+static struct profstack *profile_source(source *s)
+{
+  struct profstack *parent,*new;
+  struct profile *prof;
+  char *frame,*path,*p;
+  hashdata data;
+
+  if (s->prof != NULL)
+    return s->prof;
+  parent = s->parent!=NULL ? profile_source(s->parent) : NULL;
+
+  if (s->macro != NULL) {
+    frame = s->macro->name;
+    prof = find_profile(&macrotab,frame,1,s->macro->defsrc,s->macro->defline);
+  }
+  else if (s->srcfile!=NULL || parent==NULL) {
+    frame = s->srcfile!=NULL ? s->srcfile->name : s->name;
+    prof = find_profile(&filetab,frame,0,NULL,0);
+  }
+  else
+    return s->prof = parent;
+
+  if (parent != NULL) {
+    path = mymalloc(strlen(parent->path)+strlen(frame)+2);
+    sprintf(path,"%s;%s",parent->path,frame);
+  }
+  else
+    path = mystrdup(frame);
+  for (p=path+(parent!=NULL?strlen(parent->path)+1:0); *p; p++) {
+    if (*p==';' || isspace((unsigned char)*p))
+      *p = '_';  /* frame separators of the folded stacks format */
+  }
+
+  if (stacktab == NULL)
+    stacktab = new_hashtable(PROFHTABSIZE);
+  if (find_name(stacktab,path,&data)) {
+    myfree(path);
+    return s->prof = data.ptr;
+  }
+  new = mycalloc(sizeof(struct profstack));
+  new->path = path;
+  new->prof = prof;
+  if (last_stack)
+    last_stack = last_stack->next = new;
+  else
+    first_stack = last_stack = new;
+  data.ptr = new;
+  add_hashentry(stacktab,path,data);
+  return s->prof = new;
+}
+
+
+/* Called for every line read, NULL at the end of the sources. The time
+   since the previous line is charged to the source of that line. */
+void profile_line(source *s)
+{
+  clock_t now = clock();
+
+  if (cur_prof != NULL)
+    cur_prof->ticks += now - last_clock;
+  last_clock = now;
+  if (s != NULL) {
+    struct profstack *ps = profile_source(s);
+
+    ps->lines++;
+    ps->prof->lines++;
+    cur_prof = ps->prof;
+  }
+  else
+    cur_prof = NULL;
+}
+
+
+/* Counts the atoms of source statements. Atoms created by the backend
+   for its options or while no source line is read are ignored. */
+void profile_atom(atom *a)
+{
+  if (a->src!=NULL && cur_prof!=NULL && a->type!=OPTS && a->type!=LINE)
+    profile_source(a->src)->prof->atoms++;
+}
+
+
+void profile_resize(atom *a)
+{
+  if (a->src != NULL)
+    profile_source(a->src)->prof->resizes++;
+}
+
+
+static int compare_profiles(const void *a,const void *b)
+{
+  const struct profile *pa = *(const struct profile **)a;
+  const struct profile *pb = *(const struct profile **)b;
+
+  if (pa->ticks != pb->ticks)
+    return pa->ticks > pb->ticks ? -1 : 1;
+  if (pa->lines != pb->lines)
+    return pa->lines > pb->lines ? -1 : 1;
+  return strcmp(pa->name,pb->name);
+}
+
+
+/* Print the costs of all include files and macros, sorted by parse time,
+   and write the lines read on every expansion path to a folded stacks
+   file, which can be converted into a flame graph. */
+void profile_write(FILE *f,section *first_sec)
+{
+  struct profile *prof,**tab;
+  struct profstack *ps;
+  section *sec;
+  atom *p;
+  int n,i;
+
+  for (sec=first_sec; sec; sec=sec->next) {
+    for (p=sec->first; p; p=p->next) {
+      if (p->src != NULL)
+        profile_source(p->src)->prof->bytes += p->lastsize;
+    }
+  }
+
+  if (!nostdout) {
+    for (n=0,prof=first_profile; prof; prof=prof->next)
+      n++;
+    tab = mymalloc((n+1)*sizeof(struct profile *));
+    for (i=0,prof=first_profile; prof; prof=prof->next)
+      tab[i++] = prof;
+    qsort(tab,n,sizeof(struct profile *),compare_profiles);
+    printf("\n%10s %10s %10s %12s %8s  %s\n",
+           "parse ms","lines","atoms","bytes","resizes","file/macro");
+    for (i=0; i<n; i++) {
+      prof = tab[i];
+      printf("%10.2f %10lu %10lu %12llu %8lu  ",
+             (double)prof->ticks*1000.0/CLOCKS_PER_SEC,prof->lines,
+             prof->atoms,prof->bytes,prof->resizes);
+      if (prof->is_macro && prof->defsrc!=NULL)
+        printf("macro %s (%s:%d)\n",prof->name,
+               prof->defsrc->name,prof->defline);
+      else if (prof->is_macro)
+        printf("macro %s\n",prof->name);
+      else
+        printf("%s\n",prof->name);
+    }
+    myfree(tab);
+  }
+
+  for (ps=first_stack; ps; ps=ps->next) {
+    if (ps->lines)
+      fprintf(f,"%s %lu\n",ps->path,ps->lines);
+  }
+}
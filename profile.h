@@ -0,0 +1,37 @@
+/* profile.h - attribution of assembly costs to include files and macros */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* costs of an include file or a macro */
+struct profile {
+  struct profile *next;
+  char *name;
+  int is_macro;
+  source *defsrc;           /* where a macro was defined */
+  int defline;
+  unsigned long lines;      /* source lines read */
+  unsigned long atoms;      /* atoms produced */
+  unsigned long long bytes; /* final size of these atoms */
+  unsigned long resizes;    /* atom size changes while resolving */
+  clock_t ticks;            /* parse time */
+};
+
+/* an expansion path of includes and macros, for the folded stacks */
+struct profstack {
+  struct profstack *next;
+  char *path;
+  struct profile *prof;
+  unsigned long lines;
+};
+
+/* global variables */
+extern int profiling;
+
+/* functions */
+void profile_line(source *);
+void profile_atom(atom *);
+void profile_resize(atom *);
+void profile_write(FILE *,section *);
+
+#endif /* PROFILE_H */
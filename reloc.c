@@ -20,6 +20,10 @@ rlist *add_extnreloc(rlist **relocs,symbol *sym,taddr addend,int type,
    Use add_nreloc() for the old interface, which calculates
    byteoffset and bitoffset from offset. */
 {
+  struct rlnode {  /* rlist and its nreloc in a single allocation */
+    rlist rl;
+    nreloc r;
+  } *n;
   rlist *rl;
   nreloc *r;
 
@@ -29,13 +33,15 @@ rlist *add_extnreloc(rlist **relocs,symbol *sym,taddr addend,int type,
   /* mark symbol as referenced, so we can find unreferenced imported symbols */
   sym->flags |= REFERENCED;
 
-  r = new_nreloc();
+  n = mymalloc(sizeof(struct rlnode));
+  r = &n->r;
   r->byteoffset = byteoffs;
   r->bitoffset = bitoffs;
   r->size = size;
+  r->mask = -1;
   r->sym = sym;
   r->addend = addend;
-  rl = mymalloc(sizeof(rlist));
+  rl = &n->rl;
   rl->type = type;
   rl->reloc = r;
   rl->next = *relocs;
@@ -145,3 +151,67 @@ void print_reloc(FILE *f,int type,nreloc *p)
   print_symbol(f,p->sym);
   fprintf(f,") ");
 }
+
+
+static rlist *atom_relocs(atom *a)
+{
+  if (a->type == DATA)
+    return a->content.db->relocs;
+  if (a->type == SPACE)
+    return a->content.sb->relocs;
+  return NULL;
+}
+
+
+secreloc *collect_relocs(section *sec,size_t *nrelocs)
+/* Collect the relocations of all atoms in a section into one array of
+   fixed-size records, with the field offsets relative to the section.
+   Relocations which are no nreloc only set type, rl and a. */
+{
+  secreloc *tab,*sr;
+  rlist *rl;
+  atom *a;
+  utaddr pc;
+  size_t n;
+
+  for (a=sec->first,n=0; a; a=a->next) {
+    for (rl=atom_relocs(a); rl; rl=rl->next)
+      n++;
+  }
+  *nrelocs = n;
+  if (n == 0)
+    return NULL;
+
+  sr = tab = mymalloc(n * sizeof(secreloc));
+  for (a=sec->first,pc=0; a; a=a->next) {
+    pc = pcalign(a,pc);
+    for (rl=atom_relocs(a); rl; rl=rl->next,sr++) {
+      sr->rl = rl;
+      sr->a = a;
+      sr->type = rl->type;
+      if ((rl->type>=FIRST_STANDARD_RELOC && rl->type<=LAST_STANDARD_RELOC)
+#ifdef VASM_CPU_PPC
+          || (rl->type>LAST_STANDARD_RELOC && rl->type<=LAST_PPC_RELOC)
+#endif
+         ) {
+        nreloc *r = (nreloc *)rl->reloc;
+
+        sr->offset = pc + r->byteoffset;
+        sr->bitoffset = (unsigned short)r->bitoffset;
+        sr->size = (unsigned short)r->size;
+        sr->mask = r->mask;
+        sr->addend = r->addend;
+        sr->sym = r->sym;
+      }
+      else {
+        sr->offset = pc;
+        sr->bitoffset = sr->size = 0;
+        sr->mask = 0;
+        sr->addend = 0;
+        sr->sym = NULL;
+      }
+    }
+    pc += atom_size(a,sec,pc);
+  }
+  return tab;
+}
@@ -45,6 +45,19 @@ typedef struct rlist {
   int type;
 } rlist;
 
+/* packed relocation record, collected for a whole section */
+typedef struct secreloc {
+  utaddr offset;      /* section offset of the relocation field */
+  taddr mask;
+  taddr addend;
+  symbol *sym;
+  rlist *rl;          /* original relocation, e.g. for error messages */
+  struct atom *a;     /* atom containing the field */
+  int type;
+  unsigned short bitoffset;
+  unsigned short size;
+} secreloc;
+
 #define MAKEMASK(x) ((1LL<<(x))-1LL)
 
 
@@ -57,6 +70,7 @@ void do_pic_check(rlist *);
 taddr nreloc_real_addend(nreloc *);
 void unsupp_reloc_error(rlist *);
 void print_reloc(FILE *,int,nreloc *);
+secreloc *collect_relocs(section *,size_t *);
 
 /* old interface: byteoffset and bitoffset are calculated from offset 'o' */
 #define add_nreloc(r,y,a,t,s,o) \
@@ -500,6 +500,262 @@ taddr fwpcalign(FILE *f,atom *a,section *sec,taddr pc)
 }
 
 
+static taddr align_bytes(atom *a,section *sec,taddr pc,
+                         uint8_t **pat,taddr *patlen)
+/* number of padding bytes fwpcalign() would write in front of an atom */
+{
+  taddr n = balign(pc,a->align);
+
+  if (a->type==SPACE && a->content.sb->space==0) {  /* space align atom */
+    if (a->content.sb->maxalignbytes!=0 &&  n>a->content.sb->maxalignbytes)
+      return 0;
+    *pat = a->content.sb->fill;
+    *patlen = a->content.sb->size;
+  }
+  else {
+    *pat = sec->pad;
+    *patlen = sec->padbytes;
+  }
+  return n;
+}
+
+
+#define SECCHUNK 0x10000  /* buffer size of fwsection() */
+
+static void chunk_fill(FILE *f,uint8_t *buf,size_t *len,
+                       uint8_t *pat,size_t patlen,utaddr cnt)
+/* append cnt copies of a pattern to the chunk buffer, write full chunks */
+{
+  uint8_t *p;
+  size_t n,m;
+
+  while (cnt) {
+    if (patlen == 1) {
+      n = SECCHUNK - *len;
+      if (n > cnt)
+        n = cnt;
+      memset(buf+*len,*pat,n);
+      *len += n;
+      cnt -= n;
+    }
+    else {
+      for (p=pat,m=patlen; m; p+=n,m-=n) {
+        n = SECCHUNK - *len;
+        if (n > m)
+          n = m;
+        memcpy(buf+*len,p,n);
+        if ((*len += n) == SECCHUNK) {
+          fwdata(f,buf,*len);
+          *len = 0;
+        }
+      }
+      cnt--;
+    }
+    if (*len == SECCHUNK) {
+      fwdata(f,buf,*len);
+      *len = 0;
+    }
+  }
+}
+
+
+utaddr fwsection(FILE *f,section *sec,utaddr limit)
+/* Write the contents of a section, including alignment padding. Writing
+   stops at the first atom beyond limit bytes, a limit of 0 writes all
+   atoms. The contents are rendered into a buffer of SECCHUNK bytes, which
+   is written whenever it is full, so large space blocks are never held in
+   memory. Returns the number of bytes written. */
+{
+  static uint8_t zero;
+  uint8_t *buf,*pat;
+  utaddr pc,n,total;
+  taddr patlen;
+  size_t len;
+  atom *a;
+
+  if (limit == 0)
+    limit = ~(utaddr)0;
+  buf = mymalloc(SECCHUNK);
+  len = 0;
+  total = 0;
+
+  for (a=sec->first,pc=0; a!=NULL && pc<limit; a=a->next) {
+    n = align_bytes(a,sec,pc,&pat,&patlen);
+    pc += n;
+    total += n;
+    chunk_fill(f,buf,&len,&zero,1,n%patlen);
+    chunk_fill(f,buf,&len,pat,patlen,n/patlen);
+
+    if (a->type == DATA) {
+      chunk_fill(f,buf,&len,a->content.db->data,a->content.db->size,1);
+      total += a->content.db->size;
+    }
+    else if (a->type == SPACE) {
+      sblock *sb = a->content.sb;
+
+      chunk_fill(f,buf,&len,sb->fill,sb->size,sb->space);
+      total += sb->space * sb->size;
+    }
+    pc += atom_size(a,sec,pc);
+  }
+  fwdata(f,buf,len);
+  myfree(buf);
+  return total;
+}
+
+
+static int orgcmp(const void *sec1,const void *sec2)
+/* sort by start address, empty sections first */
+{
+  section *s1 = *(section **)sec1;
+  section *s2 = *(section **)sec2;
+
+  if (ULLTADDR(s1->org) != ULLTADDR(s2->org))
+    return ULLTADDR(s1->org) > ULLTADDR(s2->org) ? 1 : -1;
+  if (ULLTADDR(s1->pc) != ULLTADDR(s2->pc))
+    return ULLTADDR(s1->pc) > ULLTADDR(s2->pc) ? 1 : -1;
+  return 0;
+}
+
+
+section **sort_sections(section *sec,size_t *nsecs)
+/* Make an array of section pointers, sorted by their start address,
+   and check in a single sweep that no two sections overlap. */
+{
+  section *s,*last,**seclist,**slp;
+  unsigned long long end;
+  size_t n;
+
+  for (s=sec,n=0; s!=NULL; s=s->next)
+    n++;
+  seclist = mymalloc((n+1) * sizeof(section *));
+  for (s=sec,slp=seclist; s!=NULL; s=s->next)
+    *slp++ = s;
+  if (n > 1)
+    qsort(seclist,n,sizeof(section *),orgcmp);
+
+  /* each section must start behind the highest end address so far */
+  for (slp=seclist,last=NULL,end=0; slp<seclist+n; slp++) {
+    s = *slp;
+    if (last!=NULL && ULLTADDR(s->org)<end)
+      output_error(15,s->name,ULLTADDR(s->org),ULLTADDR(s->pc),
+                   last->name,ULLTADDR(last->org),ULLTADDR(last->pc));
+    if (last==NULL || ULLTADDR(s->pc)>end) {
+      end = ULLTADDR(s->pc);
+      last = s;
+    }
+  }
+
+  *nsecs = n;
+  return seclist;
+}
+
+
+void rec_init(struct recbuf *rb,size_t reclen,
+              void (*write)(FILE *,struct recbuf *))
+{
+  rb->size = 0;
+  rb->reclen = reclen<MAXRECDATA ? reclen : MAXRECDATA;
+  rb->addr = rb->pc = 0;
+  rb->write = write;
+}
+
+
+void rec_flush(FILE *f,struct recbuf *rb)
+/* write buffered data and continue with the next record address */
+{
+  if (rb->size) {
+    rb->write(f,rb);
+    rb->addr += rb->size;
+    rb->size = 0;
+  }
+}
+
+
+void rec_put(FILE *f,struct recbuf *rb,uint8_t *p,size_t n)
+/* append a block of bytes to the record buffer, flushing full records */
+{
+  size_t chunk;
+
+  rb->pc += n;
+  while (n) {
+    chunk = rb->reclen - rb->size;
+    if (chunk > n)
+      chunk = n;
+    memcpy(rb->data+rb->size,p,chunk);
+    rb->size += chunk;
+    p += chunk;
+    n -= chunk;
+    if (rb->size >= rb->reclen)
+      rec_flush(f,rb);
+  }
+}
+
+
+static void rec_align(FILE *f,struct recbuf *rb,atom *a,section *sec)
+{
+  static uint8_t zero;
+  taddr n = balign(rb->pc,a->align);
+  taddr patlen;
+  uint8_t *pat;
+
+  if (n == 0)
+    return;
+
+  if (a->type==SPACE && a->content.sb->space==0) {  /* space align atom */
+    if (a->content.sb->maxalignbytes!=0 &&  n>a->content.sb->maxalignbytes)
+      return;
+    pat = a->content.sb->fill;
+    patlen = a->content.sb->size;
+  }
+  else {
+    pat = sec->pad;
+    patlen = sec->padbytes;
+  }
+
+  while (n % patlen) {
+    rec_put(f,rb,&zero,1);
+    n--;
+  }
+  while (n >= patlen) {
+    rec_put(f,rb,pat,patlen);
+    n -= patlen;
+  }
+}
+
+
+void rec_section(FILE *f,struct recbuf *rb,section *sec)
+/* write the contents of a section as contiguous records from its org */
+{
+  size_t i;
+  atom *a;
+
+  rb->addr = rb->pc = ULLTADDR(sec->org);
+  rb->size = 0;
+  for (a=sec->first; a; a=a->next) {
+    rec_align(f,rb,a,sec);
+    if (a->type == DATA)
+      rec_put(f,rb,a->content.db->data,a->content.db->size);
+    else if (a->type == SPACE) {
+      for (i=0; i<a->content.sb->space; i++)
+        rec_put(f,rb,a->content.sb->fill,a->content.sb->size);
+    }
+  }
+  rec_flush(f,rb);
+}
+
+
+char *rec_hex(char *p,uint8_t b)
+/* put two upper case hex digits into a record line */
+{
+  static const char hexdigits[] = "0123456789ABCDEF";
+
+  *p++ = hexdigits[b >> 4];
+  *p++ = hexdigits[b & 0x0f];
+  return p;
+}
+
+
 size_t filesize(FILE *fp)
 /* @@@ Warning! filesize() only works reliably on binary streams! @@@ */
 {
@@ -521,6 +777,19 @@ int abs_path(char *path)
 }
 
 
+uint64_t cache_hash(uint64_t h,const void *p,size_t n)
+/* FNV-1a, start with CACHE_HASH_INIT */
+{
+  const uint8_t *b = p;
+
+  while (n--) {
+    h ^= *b++;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+
 int stricmp(const char *str1,const char *str2)
 {
   while (tolower((unsigned char)*str1) == tolower((unsigned char)*str2)) {
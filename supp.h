@@ -15,6 +15,17 @@ struct list {
   struct node *last;
 };
 
+/* data record buffer for hex output formats */
+#define MAXRECDATA 255
+struct recbuf {
+  uint8_t data[MAXRECDATA];
+  size_t size;              /* current number of bytes in data[] */
+  size_t reclen;            /* maximum data bytes per record */
+  unsigned long long addr;  /* address of the record in data[] */
+  unsigned long long pc;    /* address of the next byte */
+  void (*write)(FILE *,struct recbuf *);  /* writes data[] as record(s) */
+};
+
 void initlist(struct list *);
 void addtail(struct list *,struct node *);
 struct node *remnode(struct node *);
@@ -48,8 +59,17 @@ void fwsblock(FILE *,sblock *);
 void fwspace(FILE *,size_t);
 void fwalign(FILE *,taddr,taddr);
 taddr fwpcalign(FILE *,atom *,section *,taddr);
+utaddr fwsection(FILE *,section *,utaddr);
+section **sort_sections(section *,size_t *);
+void rec_init(struct recbuf *,size_t,void (*)(FILE *,struct recbuf *));
+void rec_flush(FILE *,struct recbuf *);
+void rec_put(FILE *,struct recbuf *,uint8_t *,size_t);
+void rec_section(FILE *,struct recbuf *,section *);
+char *rec_hex(char *,uint8_t);
 size_t filesize(FILE *);
 int abs_path(char *);
+#define CACHE_HASH_INIT 0xcbf29ce484222325ULL
+uint64_t cache_hash(uint64_t,const void *,size_t);
 
 int stricmp(const char *,const char *);
 int strnicmp(const char *,const char *,size_t);
@@ -2,6 +2,7 @@
 /* (c) in 2014-2018 by Volker Barthelmann and Frank Wille */
 
 #include "vasm.h"
+#include "pch.h"
 
 
 symbol *first_symbol=NULL;
@@ -446,6 +447,7 @@ regsym *new_regsym(int redef,int no_case,char *name,int type,
     rsym->reg_flags = flags;
     rsym->reg_num = num;
   }
+  pch_regsym(0,no_case,name,type,flags,num);
 
   return rsym;
 }
@@ -461,6 +463,7 @@ int undef_regsym(char *name,int no_case,int type)
   if (rsym != NULL) {
     if (rsym->reg_type == type) {
       rem_hashentry(regsymhash,name,no_case);
+      pch_regsym(1,no_case,name,type,0,0);
       return 1;
     }
     else
@@ -13,6 +13,22 @@ hashtable *new_hashtable(size_t size)
   return new;
 }
 
+void free_hashtable(hashtable *ht)
+/* free the table and its entries, but not the names */
+{
+  hashentry *p,*next;
+  size_t i;
+
+  for(i=0;i<ht->size;i++){
+    for(p=ht->entries[i];p;p=next){
+      next=p->next;
+      myfree(p);
+    }
+  }
+  myfree(ht->entries);
+  myfree(ht);
+}
+
 size_t hashcode(char *name)
 {
   size_t h = 5381;
@@ -21,6 +21,7 @@ typedef struct hashtable {
 } hashtable;
 
 hashtable *new_hashtable(size_t);
+void free_hashtable(hashtable *);
 size_t hashcode(char *);
 size_t hashcodelen(char *,int);
 size_t hashcode_nc(char *);
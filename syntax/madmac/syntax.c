@@ -3,6 +3,7 @@
 
 #include "vasm.h"
 #include "error.h"
+#include "pch.h"
 
 /* The syntax module parses the input (read_next_line), handles
    assembly-directives (section, data-storage etc.) and parses
@@ -689,6 +690,24 @@ struct {
 
 int dir_cnt = sizeof(directives) / sizeof(directives[0]);
 
+/* directives which a precompiled include file can reproduce */
+static void (*pch_dirs[])(char *) = {
+  handle_equ,handle_set,handle_if,handle_else,handle_endif,
+  handle_macro,handle_endm,handle_include
+};
+
+
+static void pch_directive(void (*func)(char *))
+{
+  size_t i;
+
+  for (i=0; i<sizeof(pch_dirs)/sizeof(pch_dirs[0]); i++) {
+    if (func == pch_dirs[i])
+      return;
+  }
+  pch_cancel();
+}
+
 
 /* checks for a valid directive, and return index when found, -1 otherwise */
 static int check_directive(char **line)
@@ -718,6 +737,8 @@ static int handle_directive(char *line)
   int idx = check_directive(&line);
 
   if (idx >= 0) {
+    if (pch_dir)
+      pch_directive(directives[idx].func);
     directives[idx].func(skip(line));
     return 1;
   }
@@ -735,7 +756,7 @@ static int oplen(char *e,char *s)
 
 void parse(void)
 {
-  char *s,*line,*inst;
+  char *s,*line,*inst,*start;
   char *ext[MAX_QUALIFIERS?MAX_QUALIFIERS:1];
   char *op[MAX_OPERANDS];
   int ext_len[MAX_QUALIFIERS?MAX_QUALIFIERS:1];
@@ -839,7 +860,9 @@ again:
     }
 
     /* check for directives */
-    s = parse_cpu_special(s);
+    s = parse_cpu_special(start=s);
+    if (s!=start && pch_dir)
+      pch_cancel();  /* cpu specific directive */
     if (ISEOL(s))
       continue;
 
@@ -2,6 +2,7 @@
 /* (c) in 2002-2019 by Frank Wille */
 
 #include "vasm.h"
+#include "pch.h"
 
 /* The syntax module parses the input (read_next_line), handles
    assembly-directives (section, data-storage etc.) and parses
@@ -1773,6 +1774,29 @@ struct {
 
 int dir_cnt = sizeof(directives) / sizeof(directives[0]);
 
+/* directives which a precompiled include file can reproduce */
+static void (*pch_dirs[])(char *) = {
+  handle_include,handle_macro,handle_endm,handle_rem,handle_erem,
+  handle_ifb,handle_ifnb,handle_ifc,handle_ifnc,handle_ifd,handle_ifnd,
+  handle_ifmacrod,handle_ifmacrond,handle_ifeq,handle_ifne,handle_ifgt,
+  handle_ifge,handle_iflt,handle_ifle,handle_else,handle_endif,
+  handle_rsreset,handle_rsset,handle_clrfo,handle_setfo,
+  handle_rs8,handle_rs16,handle_rs32,handle_rs64,handle_rs96,
+  handle_fo8,handle_fo16,handle_fo32,handle_fo64,handle_fo96
+};
+
+
+static void pch_directive(void (*func)(char *))
+{
+  size_t i;
+
+  for (i=0; i<sizeof(pch_dirs)/sizeof(pch_dirs[0]); i++) {
+    if (func == pch_dirs[i])
+      return;
+  }
+  pch_cancel();
+}
+
 
 /* checks for a valid directive, and return index when found, -1 otherwise */
 static int check_directive(char **line)
@@ -1799,6 +1823,8 @@ static int handle_directive(char *line)
   int idx = check_directive(&line);
 
   if (idx >= 0) {
+    if (pch_dir)
+      pch_directive(directives[idx].func);
     directives[idx].func(skip(line));
     return 1;
   }
@@ -1972,7 +1998,7 @@ static int execute_struct(char *name,int name_len,char *s)
 
 void parse(void)
 {
-  char *s,*line,*inst,*labname;
+  char *s,*line,*inst,*labname,*start;
   char *ext[MAX_QUALIFIERS?MAX_QUALIFIERS:1];
   char *op[MAX_OPERANDS];
   int ext_len[MAX_QUALIFIERS?MAX_QUALIFIERS:1];
@@ -2096,7 +2122,9 @@ void parse(void)
 
     s = handle_iif(s);
 
-    s = parse_cpu_special(s);
+    s = parse_cpu_special(start=s);
+    if (s!=start && pch_dir)
+      pch_cancel();  /* cpu specific directive, e.g. MACHINE or OPT */
     if (ISEOL(s))
       continue;
 
@@ -2,6 +2,7 @@
 /* (c) in 2002-2018 by Frank Wille */
 
 #include "vasm.h"
+#include "pch.h"
 
 /* The syntax module parses the input (read_next_line), handles
    assembly-directives (section, data-storage etc.) and parses
@@ -975,6 +976,26 @@ struct {
 
 int dir_cnt = sizeof(directives) / sizeof(directives[0]);
 
+/* directives which a precompiled include file can reproduce */
+static void (*pch_dirs[])(char *) = {
+  handle_include,handle_macro,handle_endm,handle_defc,
+  handle_ifd,handle_ifnd,handle_ifeq,handle_ifne,handle_ifgt,handle_ifge,
+  handle_iflt,handle_ifle,handle_ifused,handle_ifnused,
+  handle_else,handle_endif
+};
+
+
+static void pch_directive(void (*func)(char *))
+{
+  size_t i;
+
+  for (i=0; i<sizeof(pch_dirs)/sizeof(pch_dirs[0]); i++) {
+    if (func == pch_dirs[i])
+      return;
+  }
+  pch_cancel();
+}
+
 
 /* checks for a valid directive, and return index when found, -1 otherwise */
 static int check_directive(char **line)
@@ -1004,6 +1025,8 @@ static int handle_directive(char *line)
   int idx = check_directive(&line);
 
   if (idx >= 0) {
+    if (pch_dir)
+      pch_directive(directives[idx].func);
     directives[idx].func(skip(line));
     return 1;
   }
@@ -1194,7 +1217,7 @@ static char *read_next_statement(void)
 
 void parse(void)
 {
-  char *s,*line,*inst,*labname;
+  char *s,*line,*inst,*labname,*start;
   char *ext[MAX_QUALIFIERS?MAX_QUALIFIERS:1];
   char *op[MAX_OPERANDS];
   int ext_len[MAX_QUALIFIERS?MAX_QUALIFIERS:1];
@@ -1298,7 +1321,9 @@ void parse(void)
     if (*s==commentchar)
       continue;
 
-    s = parse_cpu_special(s);
+    s = parse_cpu_special(start=s);
+    if (s!=start && pch_dir)
+      pch_cancel();  /* cpu specific directive, e.g. SETDP */
     if (ISEOL(s))
       continue;
 
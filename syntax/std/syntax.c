@@ -2,6 +2,7 @@
 /* (c) in 2002-2018 by Volker Barthelmann and Frank Wille */
 
 #include "vasm.h"
+#include "pch.h"
 #include "stabs.h"
 
 /* The syntax module parses the input (read_next_line), handles
@@ -1057,6 +1058,25 @@ struct {
 
 int dir_cnt=sizeof(directives)/sizeof(directives[0]);
 
+/* directives which a precompiled include file can reproduce */
+static void (*pch_dirs[])(char *) = {
+  handle_set,handle_equiv,handle_include,handle_macro,handle_endm,
+  handle_ifd,handle_ifnd,handle_ifb,handle_ifnb,handle_ifeq,handle_ifne,
+  handle_ifgt,handle_ifge,handle_iflt,handle_ifle,handle_else,handle_endif
+};
+
+
+static void pch_directive(void (*func)(char *))
+{
+  size_t i;
+
+  for (i=0; i<sizeof(pch_dirs)/sizeof(pch_dirs[0]); i++) {
+    if (func == pch_dirs[i])
+      return;
+  }
+  pch_cancel();
+}
+
 /* checks for a valid directive, and return index when found, -1 otherwise */
 static int check_directive(char **line)
 {
@@ -1086,6 +1106,8 @@ static int handle_directive(char *line)
   int idx = check_directive(&line);
 
   if (idx >= 0) {
+    if (pch_dir)
+      pch_directive(directives[idx].func);
     directives[idx].func(skip(line));
     return 1;
   }
@@ -1148,7 +1170,9 @@ void parse(void)
     if(ISEOL(s))
       continue;
 
-    s=skip(parse_cpu_special(s));
+    s=skip(parse_cpu_special(start=s));
+    if(s!=start&&pch_dir)
+      pch_cancel();  /* cpu specific directive */
     if(ISEOL(s))
       continue;
 
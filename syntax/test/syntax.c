@@ -2,6 +2,7 @@
 /* (c) in 2002 by Volker Barthelmann */
 
 #include "vasm.h"
+#include "pch.h"
 
 /* The syntax module parses the input (read_next_line), handles
    assembly-directives (section, data-storage etc.) and parses
@@ -20,6 +21,10 @@ char commentchar=';';
 char *defsectname = NULL;
 char *defsecttype = NULL;
 
+static struct namelen endm_dirlist[] = {
+  { 4,"endm" }, { 0,0 }
+};
+
 
 char *skip(char *s)
 {
@@ -231,6 +236,23 @@ static void handle_rodatas(char *s){ handle_section(".rodata,\"adr4\"");eol(s);}
 static void handle_bsss(char *s){ handle_section(".bss,\"aurw4\"");eol(s);}
 static void handle_sbsss(char *s){ handle_section(".bss,\"aurw4\"");eol(s);}
 
+/* macro <name>: positional arguments \1..\9 */
+static void handle_macro(char *s)
+{
+  char *name;
+  if(name=parse_identifier(&s)){
+    eol(s);
+    new_macro(name,endm_dirlist,NULL);
+    myfree(name);
+  }else
+    syntax_error(10);
+}
+
+static void handle_endm(char *s)
+{
+  syntax_error(13);
+}
+
 struct {
   char *name;
   void (*func)(char *);
@@ -251,6 +273,8 @@ struct {
   "bss",handle_bsss,  
   "align",handle_align,
   "ds.b",handle_space,
+  "macro",handle_macro,
+  "endm",handle_endm,
 };
 
 int dir_cnt=sizeof(directives)/sizeof(directives[0]);
@@ -269,6 +293,9 @@ static int handle_directive(char *line)
     s++;
   if(!find_namelen(dirhash,name,s-name,&data))
     return 0;
+  if(pch_dir&&directives[data.idx].func!=handle_macro&&
+     directives[data.idx].func!=handle_endm)
+    pch_cancel();
   directives[data.idx].func(skip(s));
   return 1;
 }
@@ -276,7 +303,7 @@ static int handle_directive(char *line)
 /* Very simple, very incomplete. */
 void parse(void)
 {
-  char *s,*line,*inst,*ext[MAX_QUALIFIERS?MAX_QUALIFIERS:1],*op[MAX_OPERANDS];
+  char *s,*line,*inst,*start,*ext[MAX_QUALIFIERS?MAX_QUALIFIERS:1],*op[MAX_OPERANDS];
   int inst_len,ext_len[MAX_QUALIFIERS?MAX_QUALIFIERS:1],op_len[MAX_OPERANDS];
   int i,ext_cnt,op_cnt,par_cnt;
   instruction *ip;
@@ -301,7 +328,9 @@ void parse(void)
       free(labname);
     }
 
-    s=parse_cpu_special(s);
+    s=parse_cpu_special(start=s);
+    if(s!=start&&pch_dir)
+      pch_cancel();
 
     if(handle_directive(s))
       continue;
@@ -340,6 +369,9 @@ void parse(void)
         ext_cnt++;
     }
 
+    if(execute_macro(inst,inst_len,ext,ext_len,ext_cnt,s))
+      continue;
+
     if(!isspace((unsigned char)*s)) syntax_error(2);
     
     /* read operands, terminated by comma (unless in parentheses)  */
@@ -409,13 +441,33 @@ char *get_local_label(char **start)
 char *parse_macro_arg(struct macro *m,char *s,
                       struct namelen *param,struct namelen *arg)
 {
-  /* no macro support */
+  arg->len=0;  /* no named arguments */
+  param->name=s;
+  s=skip_operand(s);
+  param->len=s-param->name;
   return s;
 }
 
+/* expand \1..\9 and \@ in a macro */
 int expand_macro(source *src,char **line,char *d,int dlen)
 {
-  return 0;
+  char *s=*line;
+  int nc=0;
+  if(*s++!='\\')
+    return 0;
+  if(*s>='1'&&*s<='9'){
+    nc=copy_macro_param(src,*s-'1',d,dlen);
+    s++;
+  }else if(*s=='@'){
+    nc=snprintf(d,dlen,"_%06lu",src->id);
+    s++;
+    if(nc>=dlen)
+      nc=-1;
+  }else
+    return 0;
+  if(nc>=0)
+    *line=s;
+  return nc;
 }
 
 int init_syntax()
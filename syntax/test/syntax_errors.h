@@ -11,3 +11,4 @@
   "identifier expected",ERROR,                    /* 10 */
   "",WARNING,
   "expression must be constant",ERROR,
+  "unexpected endm without macro",ERROR,
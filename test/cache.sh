@@ -0,0 +1,79 @@
+#!/bin/sh
+# With -cache-dir a second run must produce the same outputs as the first
+# one. Runs with warnings or printed texts must not be cached, because a
+# cache hit would not repeat them.
+# Usage: cache.sh <vasmm68k_mot>
+
+case $1 in
+  /*) VASM=$1 ;;
+  *) VASM=`pwd`/$1 ;;
+esac
+T=${TMPDIR:-/tmp}/vasm_cache.$$
+mkdir -p $T/cache || exit 1
+trap 'rm -rf $T' 0
+cd $T
+rc=0
+
+cat >inc.i <<'EOF'
+VAL	equ	42
+EOF
+cat >plain.s <<'EOF'
+	include	"inc.i"
+	dc.w	VAL
+EOF
+cat >warn.s <<'EOF'
+	section	b,bss
+	dc.w	1
+EOF
+cat >print.s <<'EOF'
+	printt	"hello"
+	dc.w	1
+EOF
+
+# run <source> <n>: assemble into <source>.<n>, diagnostics into .out<n>
+run()
+{
+  $VASM -quiet -Fvobj -cache-dir=cache -o $1.o $1.s >$1.out$2 2>&1
+  cp $1.o $1.$2
+}
+
+for s in plain warn print; do
+  run $s 1
+  run $s 2
+  if ! cmp -s $s.1 $s.2; then
+    echo "cache: $s output of the second run differs"
+    rc=1
+  fi
+  if ! cmp -s $s.out1 $s.out2; then
+    echo "cache: $s diagnostics of the second run differ"
+    rc=1
+  fi
+done
+if ! grep -q "warning" warn.out2; then
+  echo "cache: warning missing in the second run"
+  rc=1
+fi
+if ! grep -q "hello" print.out2; then
+  echo "cache: printed text missing in the second run"
+  rc=1
+fi
+
+# only plain.s is cached, without any temporary files left behind
+set -- cache/*.man
+if [ $# != 1 ]; then
+  echo "cache: $# cache entries written, expected 1"
+  rc=1
+fi
+if ls cache | grep -q tmp; then
+  echo "cache: temporary files left in the cache"
+  rc=1
+fi
+
+# a changed include file must be assembled again
+echo "VAL equ 43" >inc.i
+run plain 3
+if cmp -s plain.1 plain.3; then
+  echo "cache: changed include file was not assembled again"
+  rc=1
+fi
+exit $rc
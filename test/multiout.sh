@@ -0,0 +1,72 @@
+#!/bin/sh
+# Every output of a run with several -F<fmt>:<file> options must be
+# identical to the output of a single run with that format, for a
+# relocatable and for an absolute (ORG) source.
+# Usage: multiout.sh <vasmm68k_mot>
+
+VASM=$1
+T=${TMPDIR:-/tmp}/vasm_multiout.$$
+mkdir -p $T || exit 1
+trap 'rm -rf $T' 0
+
+cat >$T/t.s <<'EOF'
+	section	code,code
+start:	lea	data,a0
+	move.l	#data2,d0
+	jsr	sub
+	rts
+sub:	nop
+	rts
+	section	data,data
+data:	dc.l	start,sub
+data2:	dc.w	1
+	ds.l	2
+EOF
+
+FMTS="tos xfile aout srec ihex vobj elf hunk"
+rc=0
+for f in $FMTS; do
+  $VASM -quiet -F$f -o $T/single.$f $T/t.s || exit 1
+done
+
+# the exec formats, which patch relocations into the data, come first
+set -- $FMTS
+prim=$1
+shift
+opts=
+for f in "$@"; do
+  opts="$opts -F$f:$T/multi.$f"
+done
+$VASM -quiet -F$prim -o $T/multi.$prim $opts $T/t.s || exit 1
+
+for f in $FMTS; do
+  if ! cmp -s $T/single.$f $T/multi.$f; then
+    echo "multiout: $f output differs from a single run"
+    rc=1
+  fi
+done
+
+# an absolute source: an executable together with a raw binary
+cat >$T/o.s <<'EOF'
+	org	$1000
+start:	lea	data(pc),a0
+	move.l	#data,d0
+	jsr	sub
+	rts
+sub:	nop
+	rts
+data:	dc.l	start,sub
+	dc.w	1
+	ds.l	2
+EOF
+
+$VASM -quiet -Fhunkexe -o $T/single.hunkexe $T/o.s || exit 1
+$VASM -quiet -Fbin -o $T/single.bin $T/o.s || exit 1
+$VASM -quiet -Fhunkexe -o $T/multi.hunkexe -Fbin:$T/multi.bin $T/o.s || exit 1
+for f in hunkexe bin; do
+  if ! cmp -s $T/single.$f $T/multi.$f; then
+    echo "multiout: $f output of the absolute source differs from a single run"
+    rc=1
+  fi
+done
+exit $rc
@@ -0,0 +1,76 @@
+#!/bin/sh
+# With -pch-dir a second run must produce the same output as a run without
+# precompiled includes. Only include files with nothing but definitions
+# may be precompiled, others have side effects which a .pch file would lose.
+# Usage: pch.sh <vasmm68k_mot>
+
+case $1 in
+  /*) VASM=$1 ;;
+  *) VASM=`pwd`/$1 ;;
+esac
+T=${TMPDIR:-/tmp}/vasm_pch.$$
+mkdir -p $T/pch $T/sub || exit 1
+trap 'rm -rf $T' 0
+cd $T
+rc=0
+
+cat >defs.i <<'EOF'
+FOO	equ	1
+BAR	set	FOO+1
+	ifd	FOO
+BAZ	equ	3
+	endif
+twice	macro
+	dc.w	\1,\1
+	endm
+EOF
+cat >path.i <<'EOF'
+PATH	equ	4
+	incdir	sub
+EOF
+cat >sub/inner.i <<'EOF'
+INNER	equ	5
+EOF
+cat >cpu.i <<'EOF'
+CPU	equ	6
+	machine	68020
+EOF
+cat >t.s <<'EOF'
+	include	"defs.i"
+	include	"path.i"
+	include	"inner.i"
+	include	"cpu.i"
+	twice	FOO
+	dc.w	BAR,BAZ,PATH,INNER,CPU
+	move.l	(a0,d0.l*4),d1
+EOF
+
+# run <name> [options]: assemble t.s into <name>
+run()
+{
+  n=$1
+  shift
+  if ! $VASM -quiet -Fbin "$@" -o $n t.s >$n.out 2>&1; then
+    echo "pch: $n failed:"
+    cat $n.out
+    rc=1
+  fi
+}
+
+run plain
+run first -pch-dir=pch
+run second -pch-dir=pch
+for n in first second; do
+  if ! cmp -s plain $n; then
+    echo "pch: $n run differs from a run without -pch-dir"
+    rc=1
+  fi
+done
+
+# defs.i and sub/inner.i only define symbols and macros
+set -- pch/*.pch
+if [ $# != 2 ]; then
+  echo "pch: $# precompiled include files written, expected 2"
+  rc=1
+fi
+exit $rc
@@ -0,0 +1,49 @@
+#!/bin/sh
+# The -profile table must charge the atoms and bytes of source statements
+# to the file or macro they came from, and nothing else.
+# Usage: profile.sh <vasmm68k_mot>
+
+case $1 in
+  /*) VASM=$1 ;;
+  *) VASM=`pwd`/$1 ;;
+esac
+T=${TMPDIR:-/tmp}/vasm_profile.$$
+mkdir -p $T || exit 1
+trap 'rm -rf $T' 0
+rc=0
+
+cat >$T/inner.s <<'EOF'
+inner	macro
+	nop
+	nop
+	endm
+	inner
+EOF
+cat >$T/main.s <<'EOF'
+	include	"inner.s"
+	rept	3
+	nop
+	endr
+EOF
+
+# check <name> <atoms> <bytes>: columns of the table row for name
+check()
+{
+  row=`grep " $1\$" $T/table`
+  set -- "$1" "$2" "$3" `echo "$row" | awk '{ print $3, $4 }'`
+  if [ "$4 $5" != "$2 $3" ]; then
+    echo "profile: $1 has atoms/bytes '$4 $5' instead of '$2 $3'"
+    rc=1
+  fi
+}
+
+(cd $T && $VASM -quiet -Fbin -o main.bin -profile=stacks main.s >table) ||
+  exit 1
+check "main.s" 3 6
+check "inner.s" 0 0
+check "macro inner (inner.s:1)" 2 4
+if ! grep -q '^main.s;inner.s;inner 2$' $T/stacks; then
+  echo "profile: folded stack of the macro is missing"
+  rc=1
+fi
+exit $rc
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Resolver cycles: a real cycle must be broken by fixing the oscillating
+# atoms at their maximum size and reporting them, while a source which
+# only cycles during the fast phase must converge without any warning.
+# Usage: resolve.sh <vasmm68k_mot>
+
+VASM=$1
+T=${TMPDIR:-/tmp}/vasm_resolve.$$
+mkdir -p $T || exit 1
+trap 'rm -rf $T' 0
+rc=0
+
+size()
+{
+  wc -c <$1 | tr -d ' '
+}
+
+# The branch is short, when it is long, and the other way round.
+cat >$T/cycle.s <<'EOF'
+	section	code,code
+a:	bne	x
+b:	ds.b	150-10*(b-a)
+x:	rts
+EOF
+$VASM -quiet -Fbin -o $T/cycle.bin $T/cycle.s >$T/cycle.out 2>&1
+if [ $? -ne 0 ]; then
+  echo "resolve: cycle.s failed"
+  rc=1
+fi
+if ! grep -q 'line 2 of.*atom size oscillates.*after <a>' $T/cycle.out; then
+  echo "resolve: oscillating branch in cycle.s not reported"
+  rc=1
+fi
+if [ "`size $T/cycle.bin`" != 116 ]; then
+  echo "resolve: cycle.bin has `size $T/cycle.bin` bytes instead of 116"
+  rc=1
+fi
+
+# 4 blocks of 256 bne over up to 32 labels, with 2 or 6 byte fillers,
+# cycling during the fast phase and converging in safe mode.
+awk 'BEGIN {
+  x = 1
+  print "\tsection\tcode,code"
+  for (b = 0; b < 4; b++) {
+    for (i = 0; i < 256; i++) {
+      x = (x * 75 + 74) % 65537
+      d = i + 1 + x % 32
+      if (d > 256) d = 256
+      printf "b%dl%d:\tbne\tb%dl%d\n", b, i, b, d
+      x = (x * 75 + 74) % 65537
+      if (int(x / 7) % 2) print "\tmoveq\t#1,d0"
+      else print "\tmove.l\t#$12345678,d0"
+    }
+    printf "b%dl256:\trts\n", b
+  }
+}' >$T/slow.s
+$VASM -quiet -wfail -Fbin -o $T/slow.bin $T/slow.s >$T/slow.out 2>&1
+if [ $? -ne 0 ] || grep -q warning $T/slow.out; then
+  echo "resolve: slow.s did not converge without warnings"
+  rc=1
+fi
+if [ "`size $T/slow.bin`" != 6976 ]; then
+  echo "resolve: slow.bin has `size $T/slow.bin` bytes instead of 6976"
+  rc=1
+fi
+passes=`$VASM -quiet -debug -Fbin -o $T/slow.bin $T/slow.s 2>/dev/null |
+        grep -c '^resolve_section'`
+if [ $passes -ge 100 ]; then
+  echo "resolve: slow.s needed $passes passes"
+  rc=1
+fi
+exit $rc
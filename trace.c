@@ -0,0 +1,90 @@
+/* trace.c - timeline of the assembler phases in Chrome trace format */
+
+#include <stdarg.h>
+#include "vasm.h"
+#include "osdep.h"
+
+int tracing;
+
+static FILE *tracefile;
+static unsigned long long trace_t0;
+static int nevents;
+
+
+static void trace_string(char *s)
+{
+  fputc('"',tracefile);
+  for (; *s; s++) {
+    if (*s=='"' || *s=='\\')
+      fprintf(tracefile,"\\%c",*s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(tracefile,"\\u%04x",(unsigned char)*s);
+    else
+      fputc(*s,tracefile);
+  }
+  fputc('"',tracefile);
+}
+
+
+static void trace_event(char ph)
+{
+  fprintf(tracefile,"%s{\"ph\":\"%c\",\"pid\":1,\"tid\":1,\"ts\":%llu",
+          nevents++ ? ",\n" : "[\n",ph,get_usecs()-trace_t0);
+}
+
+
+/* starts the trace file, timestamps are relative to this call */
+void trace_start(FILE *f)
+{
+  tracefile = f;
+  trace_t0 = get_usecs();
+  nevents = 0;
+  tracing = 1;
+}
+
+
+/* begins a span of category cat, which may be nested */
+void trace_begin(char *cat,char *name)
+{
+  if (tracefile) {
+    trace_event('B');
+    fprintf(tracefile,",\"cat\":");
+    trace_string(cat);
+    fprintf(tracefile,",\"name\":");
+    trace_string(name);
+    fprintf(tracefile,"}");
+  }
+}
+
+
+/* ends the innermost span, with optional arguments for it, which are
+   given as the members of a JSON object */
+void trace_end(char *args,...)
+{
+  va_list vl;
+
+  if (tracefile) {
+    trace_event('E');
+    if (args) {
+      fprintf(tracefile,",\"args\":{");
+      va_start(vl,args);
+      vfprintf(tracefile,args,vl);
+      va_end(vl);
+      fprintf(tracefile,"}");
+    }
+    fprintf(tracefile,"}");
+  }
+}
+
+
+/* Completes and closes the trace file. Spans which were not ended yet
+   (e.g. after a fatal error) are ended by the trace viewer. */
+void trace_finish(void)
+{
+  if (tracefile) {
+    fprintf(tracefile,"%s]\n",nevents ? "\n" : "[");
+    fclose(tracefile);
+    tracefile = NULL;
+  }
+  tracing = 0;
+}
@@ -0,0 +1,15 @@
+/* trace.h - timeline of the assembler phases in Chrome trace format */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/* global variables */
+extern int tracing;
+
+/* functions */
+void trace_start(FILE *);
+void trace_begin(char *,char *);
+void trace_end(char *,...);
+void trace_finish(void);
+
+#endif /* TRACE_H */
@@ -9,6 +9,7 @@
 #include "osdep.h"
 #include "stabs.h"
 #include "dwarf.h"
+#include "pch.h"
 
 #define _VER "vasm 1.8g"
 char *copyright = _VER " (c) in 2002-2019 Volker Barthelmann";
@@ -23,9 +24,19 @@ static const char *_ver = "$VER: " _VER " " __AMIGADATE__ "\r\n";
    hopefully will never happen.
    During the first FASTOPTPHASE passes all instructions of a section will be
    optimized at the same time. After that the resolver enters a safe mode,
-   where only a single instruction per pass is changed. */
+   where only a single instruction per pass is changed.
+   A pass of the fast phase only depends on the atom sizes of the previous
+   pass. When they repeat those of a pass up to MAXCYCLE passes before, the
+   section is caught in a cycle, and the passes which would only repeat it
+   until the end of the fast phase are skipped.
+   In safe mode a cycle is confirmed, when the atom sizes repeated over two
+   whole periods. All atoms which changed their size during the last period
+   are fixed at their maximum size from then on, like atoms which changed
+   their size too frequently. */
 #define MAXPASSES 1000
 #define FASTOPTPHASE 200
+#define MAXCYCLE 16
+#define MAXCYCLEREPORT 10  /* report this many oscillating atoms by line */
 
 source *cur_src;
 char *filename,*debug_filename;
@@ -60,8 +71,18 @@ struct deplist {
 };
 static struct deplist *first_depend,*last_depend;
 static char *dep_filename;
-
-static section *first_section,*last_section;
+static char *profile_name;
+static char *trace_name;
+
+/* object cache, selected by -cache-dir=<dir> */
+#define CACHE_ID "vasm object cache 2"
+static char *cache_dir;
+static uint64_t cache_key = CACHE_HASH_INIT;
+static struct deplist *first_cachefile,*last_cachefile;
+static struct deplist *first_cacheprobe,*last_cacheprobe;
+
+section *first_section;
+static section *last_section;
 #if NOT_NEEDED
 static section *prev_sec,*prev_org;
 #endif
@@ -75,18 +96,33 @@ hashtable *mnemohash;
 static int dwarf;
 static int verbose=1,auto_import=1;
 static int fail_on_warning;
-static struct include_path *first_incpath;
-static struct source_file *first_source;
+struct include_path *first_incpath;
+struct source_file *first_source;
+unsigned long source_id;
 
 static char *output_copyright;
 static void (*write_object)(FILE *,section *,symbol *);
 static int (*output_args)(char *);
 
+/* additional output files, selected by -F<fmt>:<file> */
+struct outspec {
+  struct outspec *next;
+  char *fmt;
+  char *name;
+  int exec;
+  char *copyright;
+  void (*write_object)(FILE *,section *,symbol *);
+  int (*output_args)(char *);
+};
+static struct outspec *first_outspec,*last_outspec;
+static int primary_output;
+
 
 void leave(void)
 {
   section *sec;
   symbol *sym;
+  int rc;
 
   if(outfile){
     fclose(outfile);
@@ -106,10 +142,12 @@ void leave(void)
     }
   }
 
-  if(errors||(fail_on_warning&&warnings))
-    exit(EXIT_FAILURE);
-  else
-    exit(EXIT_SUCCESS);
+  if(tracing)
+    trace_finish();
+
+  rc=errors||(fail_on_warning&&warnings)?EXIT_FAILURE:EXIT_SUCCESS;
+  server_exit(rc);
+  exit(rc);
 }
 
 /* Convert all labels from an offset-section into absolute expressions. */
@@ -172,23 +210,62 @@ static void new_stabdef(aoutnlist *nlist,section *sec)
     first_nlist = last_nlist = new;
 }
 
+static uint64_t cycle_hash(uint64_t h,size_t size)
+{
+  return (h^size)*0x100000001b3ULL;  /* FNV-1a */
+}
+
+/* fix all atoms at their maximum size, which changed since pass 'from' */
+static unsigned long break_cycle(section *sec,int from,unsigned long pinned)
+{
+  symbol *lastlabel=NULL;
+  atom *p;
+
+  for(p=sec->first;p;p=p->next){
+    if(p->type==LABEL)
+      lastlabel=p->content.label;
+    else if(p->lastpass>=from&&p->changes<=MAXSIZECHANGES){
+      if(debug)
+        printf("fixing size of oscillating atom type %d in line %d\n",
+               p->type,p->line);
+      p->changes=MAXSIZECHANGES+1;
+      if(++pinned<=MAXCYCLEREPORT){
+        if(cur_src=p->src)
+          cur_src->line=p->line;
+        general_error(76,lastlabel?lastlabel->name:sec->name);
+      }
+    }
+  }
+  return pinned;
+}
+
 static void resolve_section(section *sec)
 {
   taddr rorg_pc,org_pc;
   int fastphase=FASTOPTPHASE;
   int pass=0;
   int extrapass,rorg;
+  unsigned long changed,pinned=0;
+  uint64_t hist[2*MAXCYCLE],h;
+  char grew[2*MAXCYCLE];
+  int nhist=0,histfast=1,fast,k,m,e;
   size_t size;
   atom *p;
 
   do{
     done=1;
     rorg=0;
+    changed=0;
+    h=0xcbf29ce484222325ULL;
     if (++pass>=MAXPASSES){
+      if(pinned>MAXCYCLEREPORT)
+        general_error(77,pinned-MAXCYCLEREPORT,sec->name);
       general_error(7,sec->name);
       break;
     }
-    extrapass=pass<=fastphase;
+    if(tracing)
+      trace_begin("resolve",sec->name);
+    extrapass=fast=pass<=fastphase;
     if(debug)
       printf("resolve_section(%s) pass %d%s",sec->name,pass,
              pass<=fastphase?" (fast)\n":"\n");
@@ -233,6 +310,7 @@ static void resolve_section(section *sec)
       if(pass>fastphase&&!done&&p->type==INSTRUCTION){
         /* entered safe mode: optimize only one instruction every pass */
         sec->pc+=p->lastsize;
+        h=cycle_hash(h,p->lastsize);
         continue;
       }
       if(p->changes>MAXSIZECHANGES){
@@ -252,6 +330,10 @@ static void resolve_section(section *sec)
                  p->type,(unsigned long)sec->pc,(unsigned long)p->lastsize,
                  (unsigned long)size);
         done=0;
+        changed++;
+        if(profiling)
+          profile_resize(p);
+        p->lastpass=pass;
         if(pass>fastphase)
           p->changes++;  /* now count size modifications of atoms */
         else if(size>p->lastsize)
@@ -259,6 +341,7 @@ static void resolve_section(section *sec)
         p->lastsize=size;
       }
       sec->pc+=size;
+      h=cycle_hash(h,size);
     }
     if(rorg){
       sec->pc=org_pc+(sec->pc-rorg_pc);
@@ -267,17 +350,66 @@ static void resolve_section(section *sec)
     /* Extend the fast-optimization phase, when there was no atom which
        became larger than in the previous pass. */
     if(extrapass) fastphase++;
+    if(fast!=histfast){
+      histfast=fast;
+      nhist=0;
+    }
+    if(!done){
+      /* a cycle, when the atom sizes are the same as k passes before */
+      for(k=2;k<=nhist&&k<=MAXCYCLE;k++){
+        if(hist[(nhist-k)%(2*MAXCYCLE)]==h&&
+           (fast||(2*k<=nhist&&hist[(nhist-2*k)%(2*MAXCYCLE)]==h)))
+          break;
+      }
+      if(k<=nhist&&k<=MAXCYCLE&&fast){
+        /* skip whole periods, while all of their passes would be fast */
+        for(e=extrapass,m=1;m<k;m++)
+          e+=grew[(nhist-m)%(2*MAXCYCLE)];
+        m=k>e?(fastphase-pass-k-1)/(k-e):0;
+        if(m>(MAXPASSES-2-pass)/k)
+          m=(MAXPASSES-2-pass)/k;
+        if(m>0){
+          if(debug)
+            printf("cycle of %d passes, skipping %d passes\n",k,m*k);
+          pass+=m*k;
+          fastphase+=m*e;
+        }
+        nhist=0;
+      }
+      else if(k<=nhist&&k<=MAXCYCLE){
+        if(debug)
+          printf("cycle of %d passes\n",k);
+        general_error(78,k,sec->name);
+        pinned=break_cycle(sec,pass-k+1,pinned);
+        nhist=0;
+      }
+      else{
+        grew[nhist%(2*MAXCYCLE)]=extrapass;
+        hist[nhist++%(2*MAXCYCLE)]=h;
+      }
+    }
+    if(tracing)
+      trace_end("\"pass\":%d,\"changed\":%lu",pass,changed);
   }while(errors==0&&!done);
+  if(pinned>MAXCYCLEREPORT)
+    general_error(77,pinned-MAXCYCLEREPORT,sec->name);
 }
 
-static void resolve(void)
+void resolve(void)
 {
   section *sec;
   final_pass=0;
   if(debug)
     printf("resolve()\n");
-  for(sec=first_section;sec;sec=sec->next)
-    resolve_section(sec);
+  for(sec=first_section;sec;sec=sec->next){
+    /* all atom sizes and label addresses are final after parsing, when
+       no atom in this section may change its size */
+    if(sec->flags&NEEDS_RESOLVE)
+      resolve_section(sec);
+    else if(debug)
+      printf("resolve_section(%s) skipped\n",sec->name);
+    sec->flags&=~NEEDS_RESOLVE;  /* internal flag, don't export it */
+  }
 }
 
 static void assemble(void)
@@ -300,6 +432,8 @@ static void assemble(void)
     source *lasterrsrc=NULL;
     utaddr oldpc;
     int lasterrline=0,ovflw=0;
+    if(tracing)
+      trace_begin("assemble",sec->name);
     sec->pc=sec->org;
     bss=strchr(sec->attr,'u')!=NULL;
     for(p=sec->first;p;p=p->next){
@@ -398,10 +532,14 @@ static void assemble(void)
       else if(p->type==OPTS)
         cpu_opts(p->content.opts);
 #endif
-      else if(p->type==PRINTTEXT&&!nostdout)
+      else if(p->type==PRINTTEXT&&!nostdout){
         printf("%s",p->content.ptext);
-      else if(p->type==PRINTEXPR&&!nostdout)
+        messages++;
+      }
+      else if(p->type==PRINTEXPR&&!nostdout){
         atom_printexpr(p->content.pexpr,sec,sec->pc);
+        messages++;
+      }
       else if(p->type==ASSERT){
         assertion *ast=p->content.assert;
         taddr val;
@@ -445,6 +583,9 @@ static void assemble(void)
     }
     if(dwarf)
       dwarf_end_sequence(&dinfo,sec);
+    if(tracing)
+      trace_end("\"bytes\":%llu",
+                ULLTADDR(ULLTADDR(sec->pc)-ULLTADDR(sec->org)));
   }
   remove_unalloc_sects();
   if(dwarf)
@@ -517,6 +658,8 @@ static int init_output(char *fmt)
     return init_output_bin(&output_copyright,&write_object,&output_args);
   if(!strcmp(fmt,"srec"))
     return init_output_srec(&output_copyright,&write_object,&output_args);
+  if(!strcmp(fmt,"ihex"))
+    return init_output_ihex(&output_copyright,&write_object,&output_args);
   if(!strcmp(fmt,"vobj"))
     return init_output_vobj(&output_copyright,&write_object,&output_args);
   if(!strcmp(fmt,"hunk"))
@@ -542,7 +685,213 @@ static int init_output(char *fmt)
   return 0;
 }
 
-static int init_main(void)
+static struct outspec *new_outspec(char *arg)
+{
+  struct outspec *os=mymalloc(sizeof(struct outspec));
+  char *p=strchr(arg,':');
+
+  *p=0;
+  os->next=NULL;
+  os->fmt=arg;
+  os->name=p+1;
+  if(last_outspec)
+    last_outspec=last_outspec->next=os;
+  else
+    first_outspec=last_outspec=os;
+  return os;
+}
+
+static void init_outspecs(void)
+{
+  struct outspec *os;
+
+  for(os=first_outspec;os;os=os->next){
+    exec_out=0;
+    if(!init_output(os->fmt))
+      general_error(16,os->fmt);
+    os->exec=exec_out;
+    os->copyright=output_copyright;
+    os->write_object=write_object;
+    os->output_args=output_args;
+  }
+  exec_out=0;
+}
+
+static int outspec_args(char *arg)
+/* pass an option to every selected output module, but only once to each */
+{
+  struct outspec *os,*prev;
+  int done=primary_output?output_args(arg):0;
+
+  for(os=first_outspec;os;os=os->next){
+    if(primary_output&&os->output_args==output_args)
+      continue;
+    for(prev=first_outspec;prev!=os;prev=prev->next){
+      if(prev->output_args==os->output_args)
+        break;
+    }
+    if(prev==os)
+      done|=os->output_args(arg);
+  }
+  return done;
+}
+
+/* Output modules may relink the symbol list, add sections and atoms,
+   change section and symbol attributes or patch resolved relocations
+   into the atom data. Take a snapshot of the assembled state, so every
+   output starts from the same sections, symbols and atom contents. */
+struct atomstate {
+  atom *a;
+  char *copy;       /* DATA bytes or a copy of the sblock */
+  rlist *relocs;
+};
+
+struct outstate {
+  section *first_sec,*last_sec;
+  size_t nsecs,nsyms,natoms;
+  section **secs;
+  section *seccopy;
+  atom **lastnext;
+  symbol **syms;
+  symbol *symcopy;
+  struct atomstate *atoms;
+  char *atomdata;
+};
+
+static void save_outstate(struct outstate *st)
+{
+  section *sec;
+  symbol *sym;
+  atom *a;
+  size_t i,n;
+  char *p;
+
+  st->first_sec=first_section;
+  st->last_sec=last_section;
+  for(st->nsecs=0,sec=first_section;sec;sec=sec->next)
+    st->nsecs++;
+  for(st->nsyms=0,sym=first_symbol;sym;sym=sym->next)
+    st->nsyms++;
+  st->secs=mymalloc((st->nsecs+1)*sizeof(section *));
+  st->seccopy=mymalloc((st->nsecs+1)*sizeof(section));
+  st->lastnext=mymalloc((st->nsecs+1)*sizeof(atom *));
+  st->syms=mymalloc((st->nsyms+1)*sizeof(symbol *));
+  st->symcopy=mymalloc((st->nsyms+1)*sizeof(symbol));
+  for(i=0,sec=first_section;sec;sec=sec->next,i++){
+    st->secs[i]=sec;
+    st->seccopy[i]=*sec;
+    st->lastnext[i]=sec->last?sec->last->next:NULL;
+  }
+  for(i=0,sym=first_symbol;sym;sym=sym->next,i++){
+    st->syms[i]=sym;
+    st->symcopy[i]=*sym;
+  }
+
+  for(st->natoms=n=0,sec=first_section;sec;sec=sec->next){
+    for(a=sec->first;a;a=a->next){
+      if(a->type==DATA){
+        st->natoms++;
+        n+=a->content.db->size;
+      }
+      else if(a->type==SPACE){
+        st->natoms++;
+        n+=sizeof(sblock);
+      }
+      if(a==sec->last)
+        break;
+    }
+  }
+  st->atoms=mymalloc((st->natoms+1)*sizeof(struct atomstate));
+  p=st->atomdata=mymalloc(n+1);
+  for(i=0,sec=first_section;sec;sec=sec->next){
+    for(a=sec->first;a;a=a->next){
+      if(a->type==DATA||a->type==SPACE){
+        st->atoms[i].a=a;
+        st->atoms[i].copy=p;
+        if(a->type==DATA){
+          memcpy(p,a->content.db->data,a->content.db->size);
+          p+=a->content.db->size;
+          st->atoms[i].relocs=a->content.db->relocs;
+        }
+        else{
+          memcpy(p,a->content.sb,sizeof(sblock));
+          p+=sizeof(sblock);
+          st->atoms[i].relocs=a->content.sb->relocs;
+        }
+        i++;
+      }
+      if(a==sec->last)
+        break;
+    }
+  }
+}
+
+static void restore_outstate(struct outstate *st)
+{
+  size_t i;
+
+  first_section=st->first_sec;
+  last_section=st->last_sec;
+  for(i=0;i<st->nsecs;i++){
+    *st->secs[i]=st->seccopy[i];
+    if(st->secs[i]->last)
+      st->secs[i]->last->next=st->lastnext[i];
+  }
+  for(i=0;i<st->nsyms;i++)
+    *st->syms[i]=st->symcopy[i];
+  first_symbol=st->nsyms?st->syms[0]:NULL;
+  for(i=0;i<st->natoms;i++){
+    atom *a=st->atoms[i].a;
+
+    if(a->type==DATA){
+      memcpy(a->content.db->data,st->atoms[i].copy,a->content.db->size);
+      a->content.db->relocs=st->atoms[i].relocs;
+    }
+    else
+      memcpy(a->content.sb,st->atoms[i].copy,sizeof(sblock));
+  }
+}
+
+static void free_outstate(struct outstate *st)
+{
+  myfree(st->secs);
+  myfree(st->seccopy);
+  myfree(st->lastnext);
+  myfree(st->syms);
+  myfree(st->symcopy);
+  myfree(st->atoms);
+  myfree(st->atomdata);
+}
+
+static void write_outspecs(void)
+{
+  struct outstate st;
+  struct outspec *os;
+  int exec=exec_out;
+  FILE *f;
+
+  save_outstate(&st);
+  for(os=first_outspec;os&&errors==0;os=os->next){
+    exec_out=os->exec;
+    if(tracing)
+      trace_begin("output",os->name);
+    if(f=fopen(os->name,"wb")){
+      os->write_object(f,first_section,first_symbol);
+      fclose(f);
+      if(errors)
+        remove(os->name);
+    }
+    else
+      general_error(13,os->name);
+    if(tracing)
+      trace_end(NULL);
+    restore_outstate(&st);
+  }
+  exec_out=exec;
+  free_outstate(&st);
+}
+
+int init_main(void)
 {
   size_t i;
   char *last;
@@ -624,31 +973,196 @@ static void write_depends(FILE *f)
     fputc('\n',f);
 }
 
-int main(int argc,char **argv)
+static int cache_hash_file(char *name,uint64_t *h)
+{
+  uint8_t buf[8192];
+  size_t n;
+  FILE *f;
+
+  if (!(f = fopen(name,"rb")))
+    return 0;
+  *h = CACHE_HASH_INIT;
+  while ((n = fread(buf,1,sizeof(buf),f)) > 0)
+    *h = cache_hash(*h,buf,n);
+  fclose(f);
+  return 1;
+}
+
+static int copy_file(char *src,char *dst)
+{
+  uint8_t buf[8192];
+  FILE *in,*out;
+  size_t n;
+  int ok = 1;
+
+  if (!(in = fopen(src,"rb")))
+    return 0;
+  if (!(out = fopen(dst,"wb"))) {
+    fclose(in);
+    return 0;
+  }
+  while ((n = fread(buf,1,sizeof(buf),in)) > 0) {
+    if (fwrite(buf,1,n,out) != n) {
+      ok = 0;
+      break;
+    }
+  }
+  fclose(in);
+  if (fclose(out) != 0)
+    ok = 0;
+  return ok;
+}
+
+static char *cache_name(char *suffix)
+/* name of a file in the cache: <dir>/<key>.<suffix> */
+{
+  char *name = mymalloc(strlen(cache_dir) + strlen(suffix) + 19);
+
+  sprintf(name,"%s/%016llx.%s",cache_dir,(unsigned long long)cache_key,
+          suffix);
+  return name;
+}
+
+static char **cache_outputs(int *n)
+/* names of all output files of this run, in a fixed order */
 {
+  struct outspec *os;
+  char **names;
   int i;
-  for(i=1;i<argc;i++){
-    if(argv[i][0]=='-'&&argv[i][1]=='F'){
-      output_format=argv[i]+2;
-      argv[i][0]=0;
+
+  for (i=3,os=first_outspec; os; os=os->next)
+    i++;
+  names = mycalloc(i*sizeof(char *));
+  names[0] = primary_output ? (outname ? outname : "a.out") : NULL;
+  names[1] = produce_listing ? (listname ? listname : "a.lst") : NULL;
+  names[2] = depend ? dep_filename : NULL;
+  for (i=3,os=first_outspec; os; os=os->next)
+    names[i++] = os->name;
+  *n = i;
+  return names;
+}
+
+static int cache_copy(char **names,int n,int store)
+/* copy output files into the cache or out of it */
+{
+  char slot[16],*cname,*tmp;
+  int i,ok=1;
+
+  for (i=0; i<n && ok; i++) {
+    if (names[i]) {
+      sprintf(slot,"%d",i);
+      cname = cache_name(slot);
+      if (store) {
+        /* write a temporary file first, so a cached file is always complete */
+        tmp = mymalloc(strlen(cname) + 5);
+        sprintf(tmp,"%s.tmp",cname);
+        if (ok = copy_file(names[i],tmp)) {
+          remove(cname);
+          ok = rename(tmp,cname) == 0;
+        }
+        if (!ok)
+          remove(tmp);
+        myfree(tmp);
+      }
+      else
+        ok = copy_file(cname,names[i]);
+      myfree(cname);
     }
-    if(!strcmp("-quiet",argv[i])){
-      verbose=0;
-      argv[i][0]=0;
+  }
+  return ok;
+}
+
+static int cache_lookup(void)
+/* Check whether all input files of the cached run are unchanged,
+   then copy its outputs. Returns 0 when the cache has to be updated. */
+{
+  char line[MAXPATHLEN+32],*p,*man,*cached_out=NULL,**names;
+  unsigned long long h;
+  uint64_t fh;
+  int n,hit;
+  FILE *f,*f2;
+
+  man = cache_name("man");
+  f = fopen(man,"r");
+  myfree(man);
+  if (!f)
+    return 0;
+  hit = fgets(line,sizeof(line),f)!=NULL && !strcmp(line,CACHE_ID"\n");
+  while (hit && fgets(line,sizeof(line),f)) {
+    if (p = strchr(line,'\n'))
+      *p = '\0';
+    if (line[0]=='F' && sscanf(line+2,"%llx",&h)==1 && strlen(line)>19)
+      hit = cache_hash_file(line+19,&fh) && fh==(uint64_t)h;
+    else if (line[0]=='M') {
+      /* a file which was searched for, but not found, must still be missing */
+      if (f2 = fopen(line+2,"r")) {
+        fclose(f2);
+        hit = 0;
+      }
     }
-    if(!strcmp("-debug",argv[i])){
-      debug=1;
-      argv[i][0]=0;
+    else if (line[0]=='O')
+      cached_out = mystrdup(line+2);
+    else
+      hit = 0;
+  }
+  fclose(f);
+
+  if (hit) {
+    if (!outname && cached_out)
+      outname = cached_out;  /* set by a source directive */
+    names = cache_outputs(&n);
+    hit = cache_copy(names,n,0);
+    myfree(names);
+  }
+  return hit;
+}
+
+static void cache_store(void)
+/* copy the outputs into the cache and write a manifest of the inputs */
+{
+  struct deplist *d;
+  char **names,*tmp,*man;
+  uint64_t h;
+  int n,ok;
+  FILE *f;
+
+  names = cache_outputs(&n);
+  ok = cache_copy(names,n,1);
+  myfree(names);
+  if (!ok)
+    return;
+
+  tmp = cache_name("tmp");
+  if (f = fopen(tmp,"w")) {
+    fprintf(f,"%s\n",CACHE_ID);
+    for (d=first_cachefile; d && ok; d=d->next) {
+      if (ok = cache_hash_file(d->filename,&h))
+        fprintf(f,"F %016llx %s\n",(unsigned long long)h,d->filename);
+    }
+    for (d=first_cacheprobe; d; d=d->next)
+      fprintf(f,"M %s\n",d->filename);
+    if (outname)
+      fprintf(f,"O %s\n",outname);
+    if (fclose(f)!=0 || !ok)
+      remove(tmp);
+    else {
+      /* replace the manifest last, so it never refers to missing files */
+      man = cache_name("man");
+      remove(man);
+      rename(tmp,man);
+      myfree(man);
     }
   }
-  if(!init_output(output_format))
-    general_error(16,output_format);
-  if(!init_main())
-    general_error(10,"main");
-  if(!init_symbol())
-    general_error(10,"symbol");
-  if(verbose)
-    printf("%s\n%s\n%s\n%s\n",copyright,cpu_copyright,syntax_copyright,output_copyright);
+  myfree(tmp);
+}
+
+static void main_options(int argc,char **argv,int request)
+/* Process the options, which were not handled before initializing the
+   modules. A server request may only set the source, the output and
+   listing names, symbols, include paths and dependencies. */
+{
+  int i;
+
   for(i=1;i<argc;i++){
     if(argv[i][0]==0)
       continue;
@@ -740,6 +1254,19 @@ int main(int argc,char **argv)
       dep_filename=argv[++i];
       continue;
     }
+    if(request){
+      general_error(79,argv[i]);  /* option not allowed in a request */
+      continue;
+    }
+    if(!strncmp("-trace=",argv[i],7)){
+      trace_name=argv[i]+7;
+      continue;
+    }
+    if(!strncmp("-profile=",argv[i],9)){
+      profile_name=argv[i]+9;
+      profiling=1;
+      continue;
+    }
     if(!strcmp("-unnamed-sections",argv[i])){
       unnamed_sections=1;
       continue;
@@ -805,7 +1332,7 @@ int main(int argc,char **argv)
       continue;
     if(syntax_args(argv[i]))
       continue;
-    if(output_args(argv[i]))
+    if(outspec_args(argv[i]))
       continue;
     if(!strcmp("-esc",argv[i])){
       esc_sequences=1;
@@ -821,21 +1348,170 @@ int main(int argc,char **argv)
     }
     general_error(14,argv[i]);
   }
+}
+
+static void print_copyrights(void)
+{
+  struct outspec *os;
+
+  printf("%s\n%s\n%s\n",copyright,cpu_copyright,syntax_copyright);
+  if(primary_output)
+    printf("%s\n",output_copyright);
+  for(os=first_outspec;os;os=os->next){
+    if(!primary_output||os->copyright!=output_copyright)
+      printf("%s\n",os->copyright);
+  }
+}
+
+int main(int argc,char **argv)
+{
+  char *server_path=NULL;
+  int i;
+  int workers=0;
+
+  if(argc>1&&!strncmp("-server=",argv[1],8)){
+    server_path=argv[1]+8;
+    i=2;
+    if(i<argc&&!strncmp("-workers=",argv[i],9))
+      workers=atoi(argv[i++]+9);
+    /* the remaining options are used for every request */
+    argv[i-1]=argv[0];
+    argv+=i-1;
+    argc-=i-1;
+  }
+  for(i=1;i<argc;i++){
+    if(!strncmp("-cache-dir=",argv[i],11)){
+      cache_dir=argv[i]+11;
+      argv[i][0]=0;
+      continue;
+    }
+    if(!strncmp("-pch-dir=",argv[i],9)){
+      pch_dir=argv[i]+9;
+      argv[i][0]=0;
+      continue;
+    }
+    /* all other options select the object cache entry */
+    cache_key=cache_hash(cache_key,argv[i],strlen(argv[i])+1);
+    if(argv[i][0]=='-'&&argv[i][1]=='F'){
+      if(strchr(argv[i]+2,':'))
+        new_outspec(argv[i]+2);
+      else{
+        output_format=argv[i]+2;
+        primary_output=1;
+      }
+      argv[i][0]=0;
+    }
+    if(!strcmp("-quiet",argv[i])){
+      verbose=0;
+      argv[i][0]=0;
+    }
+    if(!strcmp("-debug",argv[i])){
+      debug=1;
+      argv[i][0]=0;
+    }
+  }
+  if(pch_dir)
+    pch_options(argc,argv,copyright);
+  init_outspecs();
+  if(!first_outspec)
+    primary_output=1;
+  if(primary_output){
+    if(!init_output(output_format))
+      general_error(16,output_format);
+  }
+  else{
+    /* only -F<fmt>:<file> outputs, the first one controls assembly */
+    exec_out=first_outspec->exec;
+    output_copyright=first_outspec->copyright;
+    write_object=first_outspec->write_object;
+    output_args=first_outspec->output_args;
+  }
+  if(!init_main())
+    general_error(10,"main");
+  if(!init_symbol())
+    general_error(10,"symbol");
+  if(verbose&&!server_path)
+    print_copyrights();
+  main_options(argc,argv,0);
+  if(server_path){
+    /* tables of the cpu and syntax modules are built once by the server */
+    internal_abs(vasmsym_name);
+    if(!init_parse())
+      general_error(10,"parse");
+    if(!init_syntax())
+      general_error(10,"syntax");
+    if(!init_cpu())
+      general_error(10,"cpu");
+    /* returns in a child process, with the arguments of a request */
+    if(!run_server(server_path,workers,&argc,&argv))
+      general_error(75,server_path);
+    for(i=1;i<argc;i++)
+      cache_key=cache_hash(cache_key,argv[i],strlen(argv[i])+1);
+    main_options(argc,argv,1);
+    if(verbose)
+      print_copyrights();
+  }
   nostdout=depend&&dep_filename==NULL; /* dependencies to stdout nothing else */
+  if(produce_listing||dwarf)
+    pch_dir=NULL;  /* include files need their line information */
+  if(trace_name){
+    FILE *f=fopen(trace_name,"w");
+    if(f)
+      trace_start(f);
+    else
+      general_error(13,trace_name);
+  }
+  if(cache_dir&&!nostdout&&!profiling){
+    struct outspec *os;
+
+    /* the cache entry also depends on the versions of all modules */
+    cache_key=cache_hash(cache_key,CACHE_ID,strlen(CACHE_ID));
+    cache_key=cache_hash(cache_key,copyright,strlen(copyright));
+    cache_key=cache_hash(cache_key,cpu_copyright,strlen(cpu_copyright));
+    cache_key=cache_hash(cache_key,syntax_copyright,strlen(syntax_copyright));
+    cache_key=cache_hash(cache_key,output_copyright,strlen(output_copyright));
+    for(os=first_outspec;os;os=os->next)
+      cache_key=cache_hash(cache_key,os->copyright,strlen(os->copyright));
+    if(tracing)
+      trace_begin("cache","lookup");
+    if(cache_lookup())
+      leave();  /* outputs were copied from the cache */
+    if(tracing)
+      trace_end(NULL);
+  }
   include_main_source();
-  internal_abs(vasmsym_name);
-  if(!init_parse())
-    general_error(10,"parse");
-  if(!init_syntax())
-    general_error(10,"syntax");
-  if(!init_cpu())
-    general_error(10,"cpu");
+  if(!server_path){
+    internal_abs(vasmsym_name);
+    if(!init_parse())
+      general_error(10,"parse");
+    if(!init_syntax())
+      general_error(10,"syntax");
+    if(!init_cpu())
+      general_error(10,"cpu");
+  }
+  if(tracing)
+    trace_begin("phase","parse");
   parse();
+  if(tracing)
+    trace_end(NULL);
   listena=0;
-  if(errors==0||produce_listing)
+#if HAVE_CPU_FINISH
+  cpu_finish();
+#endif
+  if(errors==0||produce_listing){
+    if(tracing)
+      trace_begin("phase","resolve");
     resolve();
-  if(errors==0||produce_listing)
+    if(tracing)
+      trace_end(NULL);
+  }
+  if(errors==0||produce_listing){
+    if(tracing)
+      trace_begin("phase","assemble");
     assemble();
+    if(tracing)
+      trace_end(NULL);
+  }
   cur_src=NULL;
   if(errors==0)
     undef_syms();
@@ -843,7 +1519,20 @@ int main(int argc,char **argv)
   if(produce_listing){
     if(!listname)
       listname="a.lst";
+    if(tracing)
+      trace_begin("output",listname);
     write_listing(listname);
+    if(tracing)
+      trace_end(NULL);
+  }
+  if(profiling){
+    FILE *f=fopen(profile_name,"w");
+    if(f){
+      profile_write(f,first_section);
+      fclose(f);
+    }
+    else
+      general_error(13,profile_name);
   }
   if(errors==0){
     if(depend&&dep_filename==NULL){
@@ -855,81 +1544,130 @@ int main(int argc,char **argv)
       if(depend&&dep_filename!=NULL){
         /* write dependencies to a named file first */
         FILE *depfile = fopen(dep_filename,"w");
+        if(tracing)
+          trace_begin("output",dep_filename);
         if (depfile){
           write_depends(depfile);
           fclose(depfile);
         }
         else
           general_error(13,dep_filename);
+        if(tracing)
+          trace_end(NULL);
+      }
+      /* write the additional outputs first, then the object file */
+      if(first_outspec)
+        write_outspecs();
+      if(primary_output&&errors==0){
+        if(!outname)
+          outname="a.out";
+        if(tracing)
+          trace_begin("output",outname);
+        outfile=fopen(outname,"wb");
+        if(!outfile)
+          general_error(13,outname);
+        else
+          write_object(outfile,first_section,first_symbol);
+        if(tracing)
+          trace_end(NULL);
+      }
+      /* a cache hit would not repeat any diagnostics or printed text */
+      if(cache_dir&&errors==0&&warnings==0&&messages==0){
+        if(outfile){
+          fclose(outfile);
+          outfile=NULL;
+        }
+        if(tracing)
+          trace_begin("cache","store");
+        cache_store();
+        if(tracing)
+          trace_end(NULL);
       }
-      /* write the object file */
-      if(!outname)
-        outname="a.out";
-      outfile=fopen(outname,"wb");
-      if(!outfile)
-        general_error(13,outname);
-      else
-        write_object(outfile,first_section,first_symbol);
     }
   }
   leave();
   return 0; /* not reached */
 }
 
+static void add_filelist(struct deplist **first,struct deplist **last,
+                         char *name)
+{
+  struct deplist *d = *first;
+
+  /* check if an entry with the same file name already exists */
+  while (d != NULL) {
+    if (!strcmp(d->filename,name))
+      return;
+    d = d->next;
+  }
+
+  /* append new dependency record */
+  d = mymalloc(sizeof(struct deplist));
+  d->next = NULL;
+  if (name[0]=='.'&&(name[1]=='/'||name[1]=='\\'))
+    name += 2;  /* skip "./" in paths */
+  d->filename = mystrdup(name);
+  if (*last)
+    *last = (*last)->next = d;
+  else
+    *first = *last = d;
+}
+
 static void add_depend(char *name)
 {
-  if (depend) {
-    struct deplist *d = first_depend;
+  if (depend)
+    add_filelist(&first_depend,&last_depend,name);
+}
 
-    /* check if an entry with the same file name already exists */
-    while (d != NULL) {
-      if (!strcmp(d->filename,name))
-        return;
-      d = d->next;
-    }
+static void add_cachefile(char *name)
+/* remember every opened input file for the object cache */
+{
+  if (cache_dir)
+    add_filelist(&first_cachefile,&last_cachefile,name);
+}
 
-    /* append new dependency record */
-    d = mymalloc(sizeof(struct deplist));
-    d->next = NULL;
-    if (name[0]=='.'&&(name[1]=='/'||name[1]=='\\'))
-      name += 2;  /* skip "./" in paths */
-    d->filename = mystrdup(name);
-    if (last_depend)
-      last_depend = last_depend->next = d;
-    else
-      first_depend = last_depend = d;
-  }
+static void add_cacheprobe(char *name)
+/* remember every path where an input file was searched, but not found */
+{
+  if (cache_dir)
+    add_filelist(&first_cacheprobe,&last_cacheprobe,name);
 }
 
-static FILE *open_path(char *compdir,char *path,char *name,char *mode)
+void use_file(char *path)
+/* an input file was opened: track it for dependencies and the cache */
+{
+  if (depend_all || !abs_path(path))
+    add_depend(path);
+  add_cachefile(path);
+}
+
+static FILE *open_path(char *compdir,char *path,char *name,char *mode,
+                       char *pathbuf)
 {
-  char pathbuf[MAXPATHLEN];
   FILE *f;
 
   if (strlen(compdir) + strlen(path) + strlen(name) + 1 <= MAXPATHLEN) {
     strcpy(pathbuf,compdir);
     strcat(pathbuf,path);
     strcat(pathbuf,name);
-
-    if (f = fopen(pathbuf,mode)) {
-      if (depend_all || !abs_path(pathbuf))
-        add_depend(pathbuf);
+    if (f = fopen(pathbuf,mode))
       return f;
-    }
+    add_cacheprobe(pathbuf);
   }
   return NULL;
 }
 
-FILE *locate_file(char *filename,char *mode,struct include_path **ipath_used)
+FILE *search_file(char *filename,char *mode,
+                  struct include_path **ipath_used,char *pathbuf)
+/* find a file in the include paths, pathbuf receives the real path */
 {
   struct include_path *ipath;
   FILE *f;
 
   if (abs_path(filename)) {
     /* file name is absolute, then don't use any include paths */
-    if (f = fopen(filename,mode)) {
-      if (depend_all)
-        add_depend(filename);
+    if (strlen(filename) < MAXPATHLEN && (f = fopen(filename,mode))) {
+      strcpy(pathbuf,filename);
       if (ipath_used)
         *ipath_used = NULL;  /* no path used, file name was absolute */
       return f;
@@ -938,9 +1676,9 @@ FILE *locate_file(char *filename,char *mode,struct include_path **ipath_used)
   else {
     /* locate file name in all known include paths */
     for (ipath=first_incpath; ipath; ipath=ipath->next) {
-      if ((f = open_path("",ipath->path,filename,mode)) == NULL) {
+      if ((f = open_path("",ipath->path,filename,mode,pathbuf)) == NULL) {
         if (compile_dir && !abs_path(ipath->path) &&
-            (f = open_path(compile_dir,ipath->path,filename,mode)))
+            (f = open_path(compile_dir,ipath->path,filename,mode,pathbuf)))
           ipath->compdir_based = 1;
       }
       if (f != NULL) {
@@ -950,84 +1688,136 @@ FILE *locate_file(char *filename,char *mode,struct include_path **ipath_used)
       }
     }
   }
+  return NULL;
+}
+
+FILE *locate_file(char *filename,char *mode,struct include_path **ipath_used)
+{
+  char pathbuf[MAXPATHLEN];
+  FILE *f;
+
+  if (f = search_file(filename,mode,ipath_used,pathbuf)) {
+    use_file(pathbuf);
+    return f;
+  }
   general_error(12,filename);
   return NULL;
 }
 
-source *include_source(char *inc_name)
+struct source_file *find_source_file(char *filename)
+{
+  struct source_file *srcfile;
+
+  for (srcfile=first_source; srcfile; srcfile=srcfile->next) {
+    if (!filenamecmp(srcfile->name,filename))
+      break;
+  }
+  return srcfile;
+}
+
+struct source_file *read_source_file(FILE *f,char *filename,
+                                     struct include_path *ipath)
+/* read a source text, the new source_file is not linked yet */
+{
+  struct source_file *srcfile;
+  char *text;
+  size_t size;
+
+  for (text=NULL,size=0; ; size+=SRCREADINC) {
+    size_t nchar;
+    text = myrealloc(text,size+SRCREADINC);
+    nchar = fread(text+size,1,SRCREADINC,f);
+    if (nchar < SRCREADINC) {
+      size += nchar;
+      break;
+    }
+  }
+  if (!feof(f)) {
+    myfree(text);
+    return NULL;
+  }
+  if (size > 0) {
+    text = myrealloc(text,size+2);
+    *(text+size) = '\n';
+    *(text+size+1) = '\0';
+    size++;
+  }
+  else {
+    myfree(text);
+    text = "\n";
+    size = 1;
+  }
+  srcfile = mymalloc(sizeof(struct source_file));
+  srcfile->next = NULL;
+  srcfile->name = filename;
+  srcfile->incpath = ipath;
+  srcfile->text = text;
+  srcfile->size = size;
+  srcfile->index = 0;
+  return srcfile;
+}
+
+void add_source_file(struct source_file *srcfile)
 {
   static int srcfileidx;
-  char *filename,*pathpart,*filepart;
   struct source_file **nptr = &first_source;
+
+  while (*nptr)
+    nptr = &(*nptr)->next;
+  srcfile->index = ++srcfileidx;
+  *nptr = srcfile;
+}
+
+source *include_source(char *inc_name)
+{
+  char *filename;
   struct source_file *srcfile;
   source *newsrc = NULL;
   FILE *f;
 
+  /* the span of an include file ends with its source, the main source
+     is covered by the parse span */
+  if (tracing && cur_src!=NULL)
+    trace_begin("include",inc_name);
   filename = convert_path(inc_name);
 
   /* check whether this source file name was already included */
-  while (srcfile = *nptr) {
-    if (!filenamecmp(srcfile->name,filename)) {
-      myfree(filename);
-      nptr = NULL;  /* reuse existing source in memory */
-      break;
-    }
-    nptr = &srcfile->next;
+  if (srcfile = find_source_file(filename)) {
+    /* same source was already loaded before, source_file node exists */
+    myfree(filename);
+    if (ignore_multinc)
+      srcfile = NULL;  /* ignore multiple inclusion of this source completely */
   }
-
-  if (nptr != NULL) {
+  else {
     /* allocate, locate and read a new source file */
     struct include_path *ipath;
 
     if (f = locate_file(filename,"r",&ipath)) {
-      char *text;
-      size_t size;
-
-      for (text=NULL,size=0; ; size+=SRCREADINC) {
-        size_t nchar;
-        text = myrealloc(text,size+SRCREADINC);
-        nchar = fread(text+size,1,SRCREADINC,f);
-        if (nchar < SRCREADINC) {
-          size += nchar;
-          break;
-        }
-      }
-      if (feof(f)) {
-        if (size > 0) {
-          text = myrealloc(text,size+2);
-          *(text+size) = '\n';
-          *(text+size+1) = '\0';
-          size++;
-        }
-        else {
-          myfree(text);
-          text = "\n";
-          size = 1;
-        }
-        srcfile = mymalloc(sizeof(struct source_file));
-        srcfile->next = NULL;
-        srcfile->name = filename;
-        srcfile->incpath = ipath;
-        srcfile->text = text;
-        srcfile->size = size;
-        srcfile->index = ++srcfileidx;
-        *nptr = srcfile;
-        cur_src = newsrc = new_source(filename,srcfile,text,size);
-      }
+      srcfile = read_source_file(f,filename,ipath);
+      fclose(f);
+      if (srcfile)
+        add_source_file(srcfile);
       else
         general_error(29,filename);
-      fclose(f);
     }
   }
-  else {
-    /* same source was already loaded before, source_file node exists */
-    if (ignore_multinc)
-      return NULL;  /* ignore multiple inclusion of this source completely */
 
-    /* new source instance from existing source file */
+  if (srcfile) {
+    if (pch_dir && pch_include(srcfile)) {
+      /* definitions were loaded from a precompiled include */
+      if (tracing && cur_src!=NULL)
+        trace_end("\"precompiled\":1");
+      return NULL;
+    }
+
+    /* new source instance from the source file */
     cur_src = newsrc = new_source(srcfile->name,srcfile,srcfile->text,
                                   srcfile->size);
+    if (pch_dir)
+      pch_source(newsrc);
   }
+  else if (tracing && cur_src!=NULL)
+    trace_end(NULL);
   return newsrc;
 }
 
@@ -1054,7 +1844,6 @@ section *find_section(char *name,char *attr)
 source *new_source(char *srcname,struct source_file *srcfile,
                    char *text,size_t size)
 {
-  static unsigned long id = 0;
   source *s = mymalloc(sizeof(source));
   size_t i;
   char *p;
@@ -1084,7 +1873,7 @@ source *new_source(char *srcname,struct source_file *srcfile,
   s->num_params = -1;   /* not a macro, no parameters */
   s->param[0] = emptystr;
   s->param_len[0] = 0;
-  s->id = id++;	        /* every source has unique id - important for macros */
+  s->id = source_id++;  /* every source has unique id - important for macros */
   s->srcptr = text;
   s->line = 0;
   s->bufsize = INITLINELEN;
@@ -1096,6 +1885,7 @@ source *new_source(char *srcname,struct source_file *srcfile,
   /* -1 outside of a repetition block */
   s->reptn = cur_src ? cur_src->reptn : -1;
 #endif
+  s->prof = NULL;
   return s;
 }
 
@@ -1432,7 +2222,7 @@ void write_listing(char *listname)
     }else
       fprintf(f,"                           ");
 
-    fprintf(f," %-.77s",p->txt);
+    fprintf(f," %.*s",p->txtlen<77?p->txtlen:77,p->txt);
 
     /* bei laengeren Daten den Rest ueberspringen */
     /* Block entfernen, wenn alles ausgegeben werden soll */
@@ -1527,12 +2317,16 @@ void write_listing(char *listname)
 void write_listing(char *listname)
 {
   FILE *f;
-  int nsecs,i,maxsrc=0;
+  int nsecs,i;
+  unsigned long maxsrc=0;
   section *secp;
+  source **srcs;
   listing *p;
   atom *a;
   symbol *sym;
   taddr pc;
+  /* one output chunk holds at most two rows of 16 bytes */
+  char buf[128+2*16*3],*bp;
 
   if(!(f=fopen(listname,"w"))){
     general_error(13,listname);
@@ -1541,27 +2335,36 @@ void write_listing(char *listname)
   for(nsecs=1,secp=first_section;secp;secp=secp->next)
     secp->idx=nsecs++;
   for(p=first_listing;p;p=p->next){
-    char err[6];
-    if(p->error!=0)
-      sprintf(err,"E%04d",p->error);
-    else
-      sprintf(err,"     ");
     if(p->src&&p->src->id>maxsrc)
       maxsrc=p->src->id;
-    fprintf(f,"F%02d:%04d %s %s",(int)(p->src?p->src->id:0),p->line,err,p->txt);
+    bp=buf+sprintf(buf,"F%02d:%04d ",(int)(p->src?p->src->id:0),p->line);
+    if(p->error!=0)
+      bp+=sprintf(bp,"E%04d ",p->error);
+    else{
+      memset(bp,' ',6);
+      bp+=6;
+    }
+    fwrite(buf,1,bp-buf,f);
+    fwrite(p->txt,1,p->txtlen,f);
     a=p->atom;
     pc=p->pc;
     while(a){
       if(a->type==DATA){
         int size=a->content.db->size;
+        uint8_t *dp=a->content.db->data;
+        bp=buf;
         for(i=0;i<size&&i<32;i++){
           if((i&15)==0)
-            fprintf(f,"\n               S%02d:%08lX: ",(int)(p->sec?p->sec->idx:0),(unsigned long)(pc));
-          fprintf(f," %02X",(unsigned char)a->content.db->data[i]);
+            bp+=sprintf(bp,"\n               S%02d:%08lX: ",(int)(p->sec?p->sec->idx:0),(unsigned long)(pc));
+          *bp++=' ';
+          bp=rec_hex(bp,dp[i]);
           pc++;
         }
-        if(a->content.db->relocs)
-          fprintf(f," [R]");
+        if(a->content.db->relocs){
+          memcpy(bp," [R]",4);
+          bp+=4;
+        }
+        fwrite(buf,1,bp-buf,f);
       }
       if(a->next&&a->next->list==a->list){
         a=a->next;
@@ -1569,20 +2372,29 @@ void write_listing(char *listname)
       }else
         a=0;
     }
-    fprintf(f,"\n");
+    if(p->cycles>0){
+      fprintf(f,"  [%d",p->cycles);
+      if(p->xcycles>0)
+        fprintf(f,"+%d%s",p->xcycles,p->pgcross?"p":"");
+      fprintf(f,"]");
+    }
+    fputc('\n',f);
   }
   fprintf(f,"\n\nSections:\n");
   for(secp=first_section;secp;secp=secp->next)
     fprintf(f,"S%02d  %s\n",(int)secp->idx,secp->name);
   fprintf(f,"\n\nSources:\n");
+  /* remember the first listed instance of every source id */
+  srcs=mycalloc((maxsrc+1)*sizeof(source *));
+  for(p=first_listing;p;p=p->next){
+    if(p->src&&srcs[p->src->id]==NULL)
+      srcs[p->src->id]=p->src;
+  }
   for(i=0;i<=maxsrc;i++){
-    for(p=first_listing;p;p=p->next){
-      if(p->src&&p->src->id==i){
-        fprintf(f,"F%02d  %s\n",i,p->src->name);
-        break;
-      }
-    }
+    if(srcs[i])
+      fprintf(f,"F%02d  %s\n",i,srcs[i]->name);
   }
+  myfree(srcs);
   fprintf(f,"\n\nSymbols:\n");
   for(sym=first_symbol;sym;sym=sym->next){
     print_symbol(f,sym);
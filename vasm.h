@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
+#include <time.h>
 
 typedef struct symbol symbol;
 typedef struct section section;
@@ -30,6 +31,8 @@ typedef struct regsym regsym;
 #include "atom.h"
 #include "cond.h"
 #include "supp.h"
+#include "profile.h"
+#include "trace.h"
 
 #if defined(BIGENDIAN)&&!defined(LITTLEENDIAN)
 #define LITTLEENDIAN (!BIGENDIAN)
@@ -47,6 +50,10 @@ typedef struct regsym regsym;
 #define OPERAND_OPTIONAL(p,t) 0
 #endif
 
+#ifndef INST_SIZE_FIXED
+#define INST_SIZE_FIXED(ip) 0
+#endif
+
 #ifndef START_PARENTH
 #define START_PARENTH(x) ((x)=='(')
 #endif
@@ -113,6 +120,7 @@ struct source {
 #ifdef REPTNSYM
   long reptn;
 #endif
+  struct profstack *prof;
 };
 
 /* section flags */
@@ -124,6 +132,7 @@ struct source {
 #define PREVABS 32          /* saved ABSOLUTE-flag during RORG-block */
 #define IN_RORG 64
 #define NEAR_ADDRESSING 128
+#define NEEDS_RESOLVE 256   /* atom sizes or label addresses may change */
 #define SECRSRVD (1L<<24)   /* bits 24..31 are reserved for output modules */
 
 /* section description */
@@ -159,7 +168,8 @@ typedef struct mnemonic {
 
 /* listing table */
 
-#define MAXLISTSRC 120
+#define MAXLISTSRC 120     /* maximum source text length in the listing */
+#define LISTPOOLSIZE 0x10000
 
 struct listing {
   listing *next;
@@ -169,7 +179,11 @@ struct listing {
   atom *atom;
   section *sec;
   taddr pc;
-  char txt[MAXLISTSRC];
+  int cycles;   /* cpu cycles of the instructions, set by some cpu modules */
+  int xcycles;  /* additional cycles in the worst case */
+  int pgcross;  /* worst case includes a page crossing */
+  char *txt;    /* source text, points into the source or the listing pool */
+  int txtlen;
 };
 
 
@@ -196,10 +210,22 @@ extern taddr taddrmin,taddrmax;
 
 /* provided by main assembler module */
 extern int debug;
+extern int ignore_multinc;
+extern section *first_section;
+extern struct include_path *first_incpath;
+extern struct source_file *first_source;
+extern unsigned long source_id;
 
 void leave(void);
+int init_main(void);
+void resolve(void);
 void set_default_output_format(char *);
+FILE *search_file(char *,char *,struct include_path **,char *);
 FILE *locate_file(char *,char *,struct include_path **);
+void use_file(char *);
+struct source_file *find_source_file(char *);
+struct source_file *read_source_file(FILE *,char *,struct include_path *);
+void add_source_file(struct source_file *);
 source *include_source(char *);
 source *new_source(char *,struct source_file *,char *,size_t);
 void end_source(source *);
@@ -230,7 +256,7 @@ void write_listing(char *);
 #define getdebugname() debug_filename
 
 /* provided by error.c */
-extern int errors,warnings;
+extern int errors,warnings,messages;
 extern int max_errors;
 extern int no_warn;
 
@@ -273,6 +299,9 @@ void init_instruction_ext(instruction_ext *);
 char *parse_instruction(char *,int *,char **,int *,int *);
 int set_default_qualifiers(char **,int *);
 #endif
+#if HAVE_CPU_FINISH
+void cpu_finish(void);
+#endif
 #if HAVE_CPU_OPTS
 void cpu_opts_init(section *);
 void cpu_opts(void *);
@@ -310,6 +339,7 @@ int init_output_test(char **,void (**)(FILE *,section *,symbol *),int (**)(char
 int init_output_elf(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
 int init_output_bin(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
 int init_output_srec(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
+int init_output_ihex(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
 int init_output_vobj(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
 int init_output_hunk(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
 int init_output_aout(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
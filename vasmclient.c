@@ -0,0 +1,123 @@
+/*
+ * vasmclient
+ * Passes its arguments to a vasm server, started with -server=<socket>,
+ * which assembles in the client's work directory and writes messages to
+ * the client's stdout and stderr. Exits with the assembler's exit code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MAX_WORKDIR_LEN 1024
+
+
+static int write_all(int fd,const void *buf,size_t n)
+{
+  const char *p = buf;
+  ssize_t r;
+
+  while (n) {
+    if ((r = write(fd,p,n)) < 0) {
+      if (errno == EINTR)
+        continue;
+      return 0;
+    }
+    p += r;
+    n -= (size_t)r;
+  }
+  return 1;
+}
+
+
+static int send_string(int fd,const char *s)
+{
+  uint32_t len = strlen(s);
+
+  return write_all(fd,&len,sizeof(len)) && write_all(fd,s,len);
+}
+
+
+int main(int argc,char *argv[])
+{
+  struct sockaddr_un addr;
+  struct msghdr msg;
+  struct iovec iov;
+  union {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE(2*sizeof(int))];
+  } ctrl;
+  struct cmsghdr *cm;
+  char cwd[MAX_WORKDIR_LEN];
+  int fds[2] = { 1, 2 };
+  uint32_t n;
+  int32_t rc;
+  int fd,i;
+
+  if (argc < 3) {
+    fprintf(stderr,"Usage: %s <socket> [vasm options] <source>\n",argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (strlen(argv[1]) >= sizeof(addr.sun_path) ||
+      getcwd(cwd,MAX_WORKDIR_LEN) == NULL) {
+    fprintf(stderr,"%s: bad socket name or work directory\n",argv[0]);
+    return EXIT_FAILURE;
+  }
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,argv[1]);
+  if ((fd = socket(AF_UNIX,SOCK_STREAM,0)) < 0 ||
+      connect(fd,(struct sockaddr *)&addr,sizeof(addr)) < 0) {
+    fprintf(stderr,"%s: cannot connect to <%s>: %s\n",
+            argv[0],argv[1],strerror(errno));
+    return EXIT_FAILURE;
+  }
+  fflush(stdout);
+
+  /* number of strings, together with our stdout and stderr */
+  n = argc - 1;  /* work directory and arguments */
+  iov.iov_base = &n;
+  iov.iov_len = sizeof(n);
+  memset(&msg,0,sizeof(msg));
+  memset(&ctrl,0,sizeof(ctrl));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof(ctrl.buf);
+  cm = CMSG_FIRSTHDR(&msg);
+  cm->cmsg_level = SOL_SOCKET;
+  cm->cmsg_type = SCM_RIGHTS;
+  cm->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cm),fds,sizeof(fds));
+  if (sendmsg(fd,&msg,0) != sizeof(n) || !send_string(fd,cwd)) {
+    fprintf(stderr,"%s: cannot send request\n",argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (i=2; i<argc; i++) {
+    if (!send_string(fd,argv[i])) {
+      fprintf(stderr,"%s: cannot send request\n",argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* wait for the exit code */
+  for (i=0; i<(int)sizeof(rc); ) {
+    ssize_t r = read(fd,(char *)&rc+i,sizeof(rc)-i);
+
+    if (r <= 0) {
+      if (r<0 && errno==EINTR)
+        continue;
+      fprintf(stderr,"%s: server terminated the request\n",argv[0]);
+      return EXIT_FAILURE;
+    }
+    i += r;
+  }
+  close(fd);
+  return rc;
+}
@@ -68,12 +68,26 @@ static const char *type_name[] = {
   "","obj","func","sect","file",NULL
 };
 
+#define NUM_RELOC_NAMES (sizeof(reloc_name)/sizeof(reloc_name[0]))
+
 static ubyte *vobj;   /* base address of VOBJ buffer */
 static size_t vlen;   /* length of VOBJ file in buffer */
 static ubyte *p;      /* current object pointer */
 static int bpb,bpt;   /* bits per byte, bytes per taddr */
 static taddr bptmask; /* mask LSB to fit bytes per taddr */
 
+static int nsecs,nsyms;
+static struct vobj_section *vsect;
+static struct vobj_symbol *vsymbols;
+
+/* indexes for the filters */
+static int *secidx;                 /* sections sorted by name */
+static int *symidx;                 /* symbols sorted by name */
+static struct vobj_reloc **relidx;  /* standard relocations sorted by symbol */
+static int nrelidx;
+
+static struct vobj_filter *first_filter,*last_filter;
+
 #define BPTMASK(x) (unsigned long long)((x)&bptmask)
 
 
@@ -84,6 +98,20 @@ static void print_sep(void)
 }
 
 
+static void *alloc(size_t size,const char *what)
+{
+  void *m;
+
+  if (size == 0)
+    return NULL;
+  if (!(m = malloc(size))) {
+    fprintf(stderr,"Cannot allocate %ld bytes for %s!\n",(long)size,what);
+    exit(1);
+  }
+  return m;
+}
+
+
 static taddr read_number(int is_signed)
 {
   taddr val;
@@ -147,101 +175,54 @@ static void read_symbol(struct vobj_symbol *vsym)
 }
 
 
-static void read_section(struct vobj_section *vsect,
-                         struct vobj_symbol *vsym,int nsyms)
+static void read_section(struct vobj_section *vsect,int idx)
 {
-  const char *attr;
-  unsigned long flags;
-  int align,nrelocs,i;
+  int i;
 
   vsect->offs = p - vobj;
   vsect->name = p;
   skip_string();
-  attr = p;
+  vsect->attr = p;
   skip_string();
-  flags = (unsigned long)read_number(0);
-  align = (int)read_number(0);
+  vsect->flags = (unsigned long)read_number(0);
+  vsect->align = (int)read_number(0);
   vsect->dsize = read_number(0);
-  nrelocs = (int)read_number(0);
+  vsect->nrelocs = (int)read_number(0);
   vsect->fsize = read_number(0);
 
-  print_sep();
-  printf("%08llx: SECTION \"%s\" (attributes=\"%s\")\n"
-         "Flags: %-8lx  Alignment: %-6d "
-         "Total size: %-9lld File size: %-9lld\n",
-         BPTMASK(vsect->offs),vsect->name,attr,flags,align,
-         vsect->dsize,vsect->fsize);
-  if (nrelocs)
-    printf("%d Relocation%s present.\n",nrelocs,nrelocs==1?emptystr:sstr);
-
   p += vsect->fsize;  /* skip section contents */
 
-  /* read and print relocations for this section */
-  for (i=0; i<nrelocs; i++) {
-    ubyte type;
+  /* read relocations for this section */
+  vsect->relocs = alloc(vsect->nrelocs*sizeof(struct vobj_reloc),
+                        "relocations");
+  for (i=0; i<vsect->nrelocs; i++) {
+    struct vobj_reloc *r = &vsect->relocs[i];
 
-    if (i == 0) {
-      /* print header */
-      printf("\nfile offs sectoffs pos sz mask     type     symbol+addend\n");
-    }
-    printf("%08llx: ",BPTMASK(p-vobj));
-    type = (ubyte)read_number(0);
+    r->offs = p - vobj;
+    r->type = (ubyte)read_number(0);
+    r->sec = idx;
 
-    if (type<sizeof(reloc_name)/sizeof(reloc_name[0])) {
+    if (r->type < NUM_RELOC_NAMES) {
       /* standard relocation */
-      taddr offs,mask,addend;
-      int bpos,bsiz,sym;
-      const char *basesym;
-
-      offs = read_number(0);
-      bpos = (int)read_number(0);
-      bsiz = (int)read_number(0);
-      mask = read_number(1);
-      addend = read_number(1);
-      sym = (int)read_number(0) - 1;  /* symbol index */
-
-      if (offs<0 || offs+(bpos>>3)>=vsect->dsize) {
-        printf("offset 0x%llx is outside of section!\n",
-               BPTMASK(offs+(bpos>>3)));
-        continue;
-      }
-      if (sym<0 || sym>=nsyms) {
-        printf("symbol index %d is illegal!\n",sym+1);
-        continue;
-      }
-      if (bsiz<0 || bsiz>bpt*bpb) {
-        printf("size of %d bits is illegal!\n",bsiz);
-        continue;
-      }
-      if (bpos<0 || bpos+bsiz>bpt*bpb) {
-        printf("bit field start=%d, size=%d doesn't fit into target address "
-               "type (%d bits)!\n",bpos,bsiz,bpt*bpb);
-        continue;
-      }
-
-      basesym = vsym[sym].name;
-      if (!strncmp(basesym," *current pc",12)) {
-        basesym = vsect->name;
-        /*addend += offs;*/
-      }
-      printf("%08llx  %02d %02d %8llx %-8s %s%+lld\n",
-             BPTMASK(offs),bpos,bsiz,BPTMASK(mask),
-             reloc_name[type],basesym,addend);
+      r->roffs = read_number(0);
+      r->bpos = (int)read_number(0);
+      r->bsiz = (int)read_number(0);
+      r->mask = read_number(1);
+      r->addend = read_number(1);
+      r->sym = (int)read_number(0) - 1;  /* symbol index */
+      r->rsize = 0;
     }
     else {
       /* non-standard relocation */
-      taddr rsize;
-
-      rsize = read_number(0);  /* size of special relocation entry */
-      if (rsize < 0) {
-        printf("Bad special relocation size (%d)!\n",(int)rsize);
+      r->sym = -1;
+      r->rsize = read_number(0);  /* size of special relocation entry */
+      if (r->rsize < 0) {
+        fprintf(stderr,"Bad special relocation size (%d)!\n",(int)r->rsize);
         exit(1);
       }
-      p += rsize;
+      p += r->rsize;
       if (p<vobj || p>vobj+vlen)
         break;
-      printf("special relocation type %-3d with a size of %d bytes\n",
-             (int)type,(int)rsize);
     }
   }
 
@@ -252,6 +233,80 @@ static void read_section(struct vobj_section *vsect,
 }
 
 
+static void print_reloc_header(void)
+{
+  printf("\nfile offs sectoffs pos sz mask     type     symbol+addend\n");
+}
+
+
+static void print_reloc(struct vobj_reloc *r)
+{
+  struct vobj_section *vs = &vsect[r->sec];
+
+  printf("%08llx: ",BPTMASK(r->offs));
+
+  if (r->type < NUM_RELOC_NAMES) {
+    /* standard relocation */
+    const char *basesym;
+
+    if (r->roffs<0 || r->roffs+(r->bpos>>3)>=vs->dsize) {
+      printf("offset 0x%llx is outside of section!\n",
+             BPTMASK(r->roffs+(r->bpos>>3)));
+      return;
+    }
+    if (r->sym<0 || r->sym>=nsyms) {
+      printf("symbol index %d is illegal!\n",r->sym+1);
+      return;
+    }
+    if (r->bsiz<0 || r->bsiz>bpt*bpb) {
+      printf("size of %d bits is illegal!\n",r->bsiz);
+      return;
+    }
+    if (r->bpos<0 || r->bpos+r->bsiz>bpt*bpb) {
+      printf("bit field start=%d, size=%d doesn't fit into target address "
+             "type (%d bits)!\n",r->bpos,r->bsiz,bpt*bpb);
+      return;
+    }
+
+    basesym = vsymbols[r->sym].name;
+    if (!strncmp(basesym," *current pc",12)) {
+      basesym = vs->name;
+      /*addend += offs;*/
+    }
+    printf("%08llx  %02d %02d %8llx %-8s %s%+lld\n",
+           BPTMASK(r->roffs),r->bpos,r->bsiz,BPTMASK(r->mask),
+           reloc_name[r->type],basesym,r->addend);
+  }
+  else {
+    /* non-standard relocation */
+    printf("special relocation type %-3d with a size of %d bytes\n",
+           r->type,(int)r->rsize);
+  }
+}
+
+
+static void print_section(struct vobj_section *vs)
+{
+  int i;
+
+  print_sep();
+  printf("%08llx: SECTION \"%s\" (attributes=\"%s\")\n"
+         "Flags: %-8lx  Alignment: %-6d "
+         "Total size: %-9lld File size: %-9lld\n",
+         BPTMASK(vs->offs),vs->name,vs->attr,vs->flags,vs->align,
+         vs->dsize,vs->fsize);
+  if (vs->nrelocs)
+    printf("%d Relocation%s present.\n",
+           vs->nrelocs,vs->nrelocs==1?emptystr:sstr);
+
+  for (i=0; i<vs->nrelocs; i++) {
+    if (i == 0)
+      print_reloc_header();
+    print_reloc(&vs->relocs[i]);
+  }
+}
+
+
 static const char *bind_name(int flags)
 {
   if (flags & WEAK)
@@ -264,8 +319,7 @@ static const char *bind_name(int flags)
 }
 
 
-static const char *def_name(struct vobj_symbol *vs,
-                            struct vobj_section *sec,int nsecs)
+static const char *def_name(struct vobj_symbol *vs)
 {
   switch (vs->type) {
     case EXPRESSION:
@@ -274,21 +328,196 @@ static const char *def_name(struct vobj_symbol *vs,
       return "*UND*";
     case LABSYM:
       if (vs->sec>0 && vs->sec<=nsecs)
-        return sec[vs->sec-1].name;
+        return vsect[vs->sec-1].name;
   }
   return "???";
 }
 
 
+static void print_symbol_header(void)
+{
+  printf("\n");
+  print_sep();
+  printf("SYMBOL TABLE\n"
+         "file offs bind size     type def      value    name\n");
+}
+
+
+static void print_symbol(struct vobj_symbol *vs)
+{
+  printf("%08llx: %-4s %08x %-4s %8.8s %8llx %s\n",
+         BPTMASK(vs->offs),bind_name(vs->flags),(unsigned)vs->size,
+         type_name[TYPE(vs)],def_name(vs),BPTMASK(vs->val),vs->name);
+}
+
+
+static int cmp_secidx(const void *a,const void *b)
+{
+  int i = *(const int *)a;
+  int j = *(const int *)b;
+  int c = strcmp(vsect[i].name,vsect[j].name);
+
+  return c ? c : i - j;
+}
+
+
+static int cmp_symidx(const void *a,const void *b)
+{
+  int i = *(const int *)a;
+  int j = *(const int *)b;
+  int c = strcmp(vsymbols[i].name,vsymbols[j].name);
+
+  return c ? c : i - j;
+}
+
+
+static int cmp_relidx(const void *a,const void *b)
+{
+  const struct vobj_reloc *r1 = *(const struct vobj_reloc **)a;
+  const struct vobj_reloc *r2 = *(const struct vobj_reloc **)b;
+
+  if (r1->sym != r2->sym)
+    return r1->sym < r2->sym ? -1 : 1;
+  return r1->offs < r2->offs ? -1 : (r1->offs > r2->offs);
+}
+
+
+static void build_indexes(void)
+/* sort sections and symbols by name and standard relocations by symbol,
+   so filters can be answered with a binary search */
+{
+  int i,j;
+
+  secidx = alloc(nsecs*sizeof(int),"section index");
+  for (i=0; i<nsecs; i++)
+    secidx[i] = i;
+  qsort(secidx,nsecs,sizeof(int),cmp_secidx);
+
+  symidx = alloc(nsyms*sizeof(int),"symbol index");
+  for (i=0; i<nsyms; i++)
+    symidx[i] = i;
+  qsort(symidx,nsyms,sizeof(int),cmp_symidx);
+
+  for (nrelidx=0,i=0; i<nsecs; i++)
+    nrelidx += vsect[i].nrelocs;
+  relidx = alloc(nrelidx*sizeof(struct vobj_reloc *),"relocation index");
+  for (nrelidx=0,i=0; i<nsecs; i++) {
+    for (j=0; j<vsect[i].nrelocs; j++) {
+      if (vsect[i].relocs[j].sym >= 0)
+        relidx[nrelidx++] = &vsect[i].relocs[j];
+    }
+  }
+  qsort(relidx,nrelidx,sizeof(struct vobj_reloc *),cmp_relidx);
+}
+
+
+static const char *section_name(int i)
+{
+  return vsect[i].name;
+}
+
+
+static const char *symbol_name(int i)
+{
+  return vsymbols[i].name;
+}
+
+
+static int find_name(int *idx,int n,const char *(*name_of)(int),
+                     const char *name)
+/* return position of the first index entry with this name, or n */
+{
+  int lo=0,hi=n,mid;
+
+  while (lo < hi) {
+    mid = lo + (hi-lo)/2;
+    if (strcmp(name_of(idx[mid]),name) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+static int find_relocs(int sym)
+/* return position of the first relocation referencing symbol sym */
+{
+  int lo=0,hi=nrelidx,mid;
+
+  while (lo < hi) {
+    mid = lo + (hi-lo)/2;
+    if (relidx[mid]->sym < sym)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+static int filter_section(const char *name)
+{
+  int i,found=0;
+
+  for (i=find_name(secidx,nsecs,section_name,name);
+       i<nsecs && !strcmp(vsect[secidx[i]].name,name); i++) {
+    print_section(&vsect[secidx[i]]);
+    found = 1;
+  }
+  return found;
+}
+
+
+static int filter_symbol(const char *name)
+{
+  int i,found=0;
+
+  for (i=find_name(symidx,nsyms,symbol_name,name);
+       i<nsyms && !strcmp(vsymbols[symidx[i]].name,name); i++) {
+    if (!found)
+      print_symbol_header();
+    print_symbol(&vsymbols[symidx[i]]);
+    found = 1;
+  }
+  return found;
+}
+
+
+static int filter_relocs(const char *name)
+{
+  int i,j,sec,found=0;
+
+  for (i=find_name(symidx,nsyms,symbol_name,name);
+       i<nsyms && !strcmp(vsymbols[symidx[i]].name,name); i++) {
+    if (!found) {
+      print_sep();
+      printf("RELOCATIONS FOR \"%s\"\n",name);
+      found = 1;
+    }
+    sec = -1;
+    for (j=find_relocs(symidx[i]);
+         j<nrelidx && relidx[j]->sym==symidx[i]; j++) {
+      if (relidx[j]->sec != sec) {
+        sec = relidx[j]->sec;
+        printf("\nSECTION \"%s\"",vsect[sec].name);
+        print_reloc_header();
+      }
+      print_reloc(relidx[j]);
+    }
+  }
+  return found;
+}
+
+
 static int vobjdump(void)
 {
   p = vobj;
 
   if (vlen>4 && p[0]==0x56 && p[1]==0x4f && p[2]==0x42 && p[3]==0x4a) {
-    int endian,nsecs,nsyms,i;
+    int endian,i,rc=0;
     const char *cpu_name;
-    struct vobj_symbol *vsymbols = NULL;
-    struct vobj_section *vsect = NULL;
+    struct vobj_filter *vf;
 
     p += 4;	/* skip ID */
     endian = (int)*p++;  /* endianess */
@@ -315,6 +544,16 @@ static int vobjdump(void)
     nsecs = (int)read_number(0);  /* number of sections */
     nsyms = (int)read_number(0);  /* number of symbols */
 
+    /* read symbols */
+    vsymbols = alloc(nsyms*sizeof(struct vobj_symbol),"symbols");
+    for (i=0; i<nsyms; i++)
+      read_symbol(&vsymbols[i]);
+
+    /* read sections and relocations */
+    vsect = alloc(nsecs*sizeof(struct vobj_section),"sections");
+    for (i=0; i<nsecs; i++)
+      read_section(&vsect[i],i);
+
     /* print header */
     print_sep();
     printf("VOBJ %s (%s endian), %d bits per byte, %d bytes per word.\n"
@@ -322,46 +561,45 @@ static int vobjdump(void)
            cpu_name,endian_name[endian-1],bpb,bpt,
            nsyms,nsyms==1?emptystr:sstr,nsecs,nsecs==1?emptystr:sstr);
 
-    /* read symbols */
-    if (nsyms) {
-      if (vsymbols = malloc(nsyms * sizeof(struct vobj_symbol))) {
-        for (i=0; i<nsyms; i++)
-          read_symbol(&vsymbols[i]);
-      }
-      else {
-        fprintf(stderr,"Cannot allocate %ld bytes for symbols!\n",
-                (long)(nsyms * sizeof(struct vobj_symbol)));
-        return 1;
+    if (first_filter) {
+      /* print selected sections, symbols and relocations only */
+      build_indexes();
+      for (vf=first_filter; vf; vf=vf->next) {
+        int found;
+
+        switch (vf->type) {
+          case FILTER_SECTION:
+            found = filter_section(vf->name);
+            break;
+          case FILTER_SYMBOL:
+            found = filter_symbol(vf->name);
+            break;
+          default:
+            found = filter_relocs(vf->name);
+            break;
+        }
+        if (!found) {
+          fprintf(stderr,"%s \"%s\" not found!\n",
+                  vf->type==FILTER_SECTION?"Section":"Symbol",vf->name);
+          rc = 1;
+        }
       }
+      return rc;
     }
 
-    /* read and print sections */
-    if (vsect = malloc(nsecs * sizeof(struct vobj_section))) {
-      for (i=0; i<nsecs; i++)
-        read_section(&vsect[i],vsymbols,nsyms);
-    }
-    else {
-      fprintf(stderr,"Cannot allocate %ld bytes for sections!\n",
-              (long)(nsecs * sizeof(struct vobj_section)));
-      return 1;
-    }
+    /* print sections */
+    for (i=0; i<nsecs; i++)
+      print_section(&vsect[i]);
 
     /* print symbols */
     for (i=0; i<nsyms; i++) {
       struct vobj_symbol *vs = &vsymbols[i];
 
-      if (i == 0) {
-        printf("\n");
-        print_sep();
-        printf("SYMBOL TABLE\n"
-               "file offs bind size     type def      value    name\n");
-      }
+      if (i == 0)
+        print_symbol_header();
       if (!strncmp(vs->name," *current pc",12))
         continue;
-      printf("%08llx: %-4s %08x %-4s %8.8s %8llx %s\n",
-             BPTMASK(vs->offs),bind_name(vs->flags),(unsigned)vs->size,
-             type_name[TYPE(vs)],def_name(vs,vsect,nsecs),
-             BPTMASK(vs->val),vs->name);
+      print_symbol(vs);
     }
   }
   else {
@@ -373,6 +611,34 @@ static int vobjdump(void)
 }
 
 
+#ifdef UNIX
+static int vobjdump_file(const char *name)
+/* map the object file into memory and dump it */
+{
+  struct stat st;
+  int fd,rc=1;
+
+  if ((fd = open(name,O_RDONLY)) >= 0) {
+    if (fstat(fd,&st)==0 && st.st_size>0) {
+      vlen = (size_t)st.st_size;
+      if ((vobj = mmap(NULL,vlen,PROT_READ,MAP_PRIVATE,fd,0)) != MAP_FAILED) {
+        rc = vobjdump();
+        munmap(vobj,vlen);
+      }
+      else
+        fprintf(stderr,"Cannot map \"%s\" into memory!\n",name);
+    }
+    else
+      fprintf(stderr,"Cannot determine size of file \"%s\"!\n",name);
+    close(fd);
+  }
+  else
+    fprintf(stderr,"Cannot open \"%s\" for reading!\n",name);
+  return rc;
+}
+
+#else
+
 static size_t filesize(FILE *fp,const char *name)
 {
   long oldpos,size;
@@ -387,34 +653,77 @@ static size_t filesize(FILE *fp,const char *name)
 }
 
 
-int main(int argc,char *argv[])
+static int vobjdump_file(const char *name)
+/* read the object file into a buffer and dump it */
 {
+  FILE *f;
   int rc = 1;
 
-  if (argc == 2) {
-    FILE *f;
-
-    if (f = fopen(argv[1],"rb")) {
-      if (vlen = filesize(f,argv[1])) {
-        if (vobj = malloc(vlen)) {
-          if (fread(vobj,1,vlen,f) == vlen)
-            rc = vobjdump();
-          else
-            fprintf(stderr,"Read error on \"%s\"!\n",argv[1]);
-          free(vobj);
-        }
+  if (f = fopen(name,"rb")) {
+    if (vlen = filesize(f,name)) {
+      if (vobj = malloc(vlen)) {
+        if (fread(vobj,1,vlen,f) == vlen)
+          rc = vobjdump();
         else
-          fprintf(stderr,"Unable to allocate %lu bytes "
-                  "to buffer file \"%s\"!\n",vlen,argv[1]);
+          fprintf(stderr,"Read error on \"%s\"!\n",name);
+        free(vobj);
       }
-      fclose(f);
-    }    
-    else
-      fprintf(stderr,"Cannot open \"%s\" for reading!\n",argv[1]);
+      else
+        fprintf(stderr,"Unable to allocate %lu bytes "
+                "to buffer file \"%s\"!\n",(unsigned long)vlen,name);
+    }
+    fclose(f);
   }
   else
-    fprintf(stderr,"vobjdump V0.5\nWritten by Frank Wille\n"
-            "Usage: %s <file name>\n",argv[0]);
-
+    fprintf(stderr,"Cannot open \"%s\" for reading!\n",name);
   return rc;
 }
+#endif
+
+
+static void add_filter(int type,const char *name)
+{
+  struct vobj_filter *vf = alloc(sizeof(struct vobj_filter),"filters");
+
+  vf->next = NULL;
+  vf->type = type;
+  vf->name = name;
+  if (last_filter)
+    last_filter = last_filter->next = vf;
+  else
+    first_filter = last_filter = vf;
+}
+
+
+int main(int argc,char *argv[])
+{
+  const char *name = NULL;
+  int i;
+
+  for (i=1; i<argc; i++) {
+    if (!strncmp(argv[i],"--section=",10))
+      add_filter(FILTER_SECTION,argv[i]+10);
+    else if (!strncmp(argv[i],"--symbol=",9))
+      add_filter(FILTER_SYMBOL,argv[i]+9);
+    else if (!strncmp(argv[i],"--relocs-for=",13))
+      add_filter(FILTER_RELOCS,argv[i]+13);
+    else if (argv[i][0]!='-' && name==NULL)
+      name = argv[i];
+    else {
+      name = NULL;
+      break;
+    }
+  }
+
+  if (name != NULL)
+    return vobjdump_file(name);
+
+  fprintf(stderr,"vobjdump V0.6\nWritten by Frank Wille\n"
+          "Usage: %s [options] <file name>\n"
+          "Options:\n"
+          "  --section=<name>     only print the named section\n"
+          "  --symbol=<name>      only print the named symbol\n"
+          "  --relocs-for=<name>  only print relocations referencing <name>\n",
+          argv[0]);
+  return 1;
+}
@@ -8,6 +8,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#ifdef UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 /* symbol types */
 #define LABSYM 1
@@ -38,10 +44,35 @@ struct vobj_symbol {
   taddr val;
 };
 
+struct vobj_reloc {
+  size_t offs;          /* file offset */
+  int type;
+  int sec;              /* index of the section containing the relocation */
+  int sym;              /* symbol index, -1 for special relocations */
+  int bpos,bsiz;
+  taddr roffs,mask,addend;
+  taddr rsize;          /* size of a special relocation */
+};
+
 struct vobj_section {
   size_t offs;
   const char *name;
+  const char *attr;
+  unsigned long flags;
+  int align,nrelocs;
   taddr dsize,fsize;
+  struct vobj_reloc *relocs;
+};
+
+/* filters, selected by --section, --symbol and --relocs-for */
+#define FILTER_SECTION 1
+#define FILTER_SYMBOL  2
+#define FILTER_RELOCS  3
+
+struct vobj_filter {
+  struct vobj_filter *next;
+  int type;
+  const char *name;
 };
 
 #define makemask(x) ((taddr)(1LL<<(x))-1)